@@ -0,0 +1,594 @@
+#include "Analyzer.h"
+#include <algorithm>
+#include <cstdio>
+
+
+// Flags in RomAnalysis::leaders, one byte per code address
+static const uint8_t INSTRUCTION_START = 1u << 0;
+static const uint8_t BLOCK_START = 1u << 1;
+
+static uint16_t OpcodeAt(Chip8 const& chip8, unsigned int address)
+{
+	return static_cast<uint16_t>((chip8.memory[address & 0x0FFFu] << 8u) | chip8.memory[(address + 1) & 0x0FFFu]);
+}
+
+static bool IsLongLoad(Chip8 const& chip8, uint16_t opcode)
+{
+	return (chip8.Quirks() & QUIRK_XOCHIP) != 0 && (opcode & 0xF0FFu) == 0xF000u;
+}
+
+// Where control goes after one instruction, as Chip8's handlers would send it
+struct Flow
+{
+	unsigned int length;
+	bool endsBlock;
+	bool indirect;
+	uint16_t call;					// NO_SUCCESSOR unless a 2nnn
+	uint16_t next[2];
+	unsigned int nextCount;
+};
+
+static Flow FlowAt(Chip8 const& chip8, uint16_t address)
+{
+	uint16_t opcode = OpcodeAt(chip8, address);
+	uint32_t quirks = chip8.Quirks();
+
+	Flow flow{};
+	flow.length = IsLongLoad(chip8, opcode) ? 4 : 2;
+	flow.call = BasicBlock::NO_SUCCESSOR;
+
+	uint16_t following = (address + flow.length) & 0x0FFFu;
+
+	if (!chip8.IsValid(opcode))
+	{
+		flow.endsBlock = true;
+		return flow;
+	}
+
+	bool skip = false;
+
+	switch (opcode >> 12u)
+	{
+	case 0x0:
+	{
+		// Without SCHIP any 00xE is RET
+		bool ret = (quirks & QUIRK_SCHIP) != 0 ? (opcode & 0xFFu) == 0xEE : (opcode & 0xFu) == 0xE;
+		bool exit = (quirks & QUIRK_SCHIP) != 0 && (opcode & 0xFFu) == 0xFD;
+
+		flow.endsBlock = ret || exit;
+	}break;
+
+	case 0x1:
+	{
+		flow.endsBlock = true;
+		flow.next[flow.nextCount++] = opcode & 0x0FFFu;
+	}break;
+
+	case 0x2:
+	{
+		flow.endsBlock = true;
+		flow.call = opcode & 0x0FFFu;
+		flow.next[flow.nextCount++] = flow.call;
+		flow.next[flow.nextCount++] = following;
+	}break;
+
+	case 0x5:
+	{
+		// 5xy2 and 5xy3 are transfers on XO-CHIP
+		skip = (quirks & QUIRK_XOCHIP) == 0 || (opcode & 0xFu) == 0;
+	}break;
+
+	case 0x3:
+	case 0x4:
+	case 0x9:
+	case 0xE:
+	{
+		skip = true;
+	}break;
+
+	case 0xB:
+	{
+		flow.endsBlock = true;
+		flow.indirect = true;
+	}break;
+
+	default:
+		break;
+	}
+
+	if (skip)
+	{
+		// XO-CHIP skips all four bytes of an F000 nnnn
+		uint16_t skipped = OpcodeAt(chip8, following);
+		unsigned int skipLength = (quirks & QUIRK_XOCHIP) != 0 && skipped == 0xF000u ? 4 : 2;
+
+		flow.endsBlock = true;
+		flow.next[flow.nextCount++] = following;
+		flow.next[flow.nextCount++] = (following + skipLength) & 0x0FFFu;
+	}
+
+	if (!flow.endsBlock)
+	{
+		flow.next[flow.nextCount++] = following;
+	}
+
+	return flow;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Follow Every Path Out of pc			//
+//											//
+//////////////////////////////////////////////
+
+void RomAnalysis::Analyze(Chip8 const& chip8)
+{
+	kinds.assign(static_cast<size_t>(AddressMaskOf(chip8.Quirks())) + 1, ByteKind::Unknown);
+	leaders.assign(CODE_SIZE, 0);
+	blocks.clear();
+	calls.clear();
+	blockStarts.clear();
+	entryIndex.clear();
+
+	indirectJumps = 0;
+	codeWrites = 0;
+	untrackedWrites = 0;
+
+	FindCode(chip8);
+	BuildBlocks(chip8);
+	TrackIndex(chip8);
+}
+
+void RomAnalysis::FindCode(Chip8 const& chip8)
+{
+	std::vector<uint16_t> pending;
+	pending.push_back(chip8.pc & 0x0FFFu);
+	leaders[pending.back()] |= BLOCK_START;
+
+	while (!pending.empty())
+	{
+		uint16_t address = pending.back();
+		pending.pop_back();
+
+		if ((leaders[address] & INSTRUCTION_START) != 0)
+		{
+			continue;
+		}
+
+		leaders[address] |= INSTRUCTION_START;
+
+		Flow flow = FlowAt(chip8, address);
+
+		for (unsigned int i = 0; i < flow.length; ++i)
+		{
+			kinds[(address + i) & 0x0FFFu] = ByteKind::Code;
+		}
+
+		indirectJumps += flow.indirect;
+
+		if (flow.call != BasicBlock::NO_SUCCESSOR)
+		{
+			calls.push_back({ address, flow.call });
+		}
+
+		for (unsigned int i = 0; i < flow.nextCount; ++i)
+		{
+			uint16_t next = flow.next[i];
+
+			// Falling off the end of memory wraps, start a block there so
+			// none of them wrap
+			if (flow.endsBlock || next < address)
+			{
+				leaders[next] |= BLOCK_START;
+			}
+
+			pending.push_back(next);
+		}
+	}
+
+	std::sort(calls.begin(), calls.end(), [](CallEdge const& a, CallEdge const& b)
+	{
+		return a.site < b.site;
+	});
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Split the Code into Basic Blocks		//
+//											//
+//////////////////////////////////////////////
+
+void RomAnalysis::BuildBlocks(Chip8 const& chip8)
+{
+	for (unsigned int start = 0; start < CODE_SIZE; ++start)
+	{
+		if ((leaders[start] & BLOCK_START) == 0)
+		{
+			continue;
+		}
+
+		BasicBlock block;
+		block.start = static_cast<uint16_t>(start);
+		block.successors[0] = block.successors[1] = BasicBlock::NO_SUCCESSOR;
+
+		uint16_t address = block.start;
+
+		for (;;)
+		{
+			Flow flow = FlowAt(chip8, address);
+			uint16_t following = static_cast<uint16_t>(address + flow.length);
+
+			// Carries on into the next instruction unless that starts a block
+			bool continues = !flow.endsBlock && following < CODE_SIZE && (leaders[following] & BLOCK_START) == 0;
+
+			if (continues)
+			{
+				address = following;
+				continue;
+			}
+
+			block.last = address;
+			block.end = following;
+
+			for (unsigned int i = 0; i < flow.nextCount; ++i)
+			{
+				block.successors[i] = flow.next[i];
+			}
+
+			break;
+		}
+
+		blocks.push_back(block);
+		blockStarts.push_back(block.start);
+	}
+}
+
+size_t RomAnalysis::BlockAt(uint16_t address) const
+{
+	return std::lower_bound(blockStarts.begin(), blockStarts.end(), address) - blockStarts.begin();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		Track I Through the Graph			//
+//											//
+//////////////////////////////////////////////
+
+void RomAnalysis::TrackIndex(Chip8 const& chip8)
+{
+	entryIndex.assign(blocks.size(), I_UNSEEN);
+
+	std::vector<size_t> pending;
+	std::vector<uint8_t> queued(blocks.size(), 0);
+
+	size_t entry = BlockAt(chip8.pc & 0x0FFFu);
+	entryIndex[entry] = chip8.index;
+	pending.push_back(entry);
+	queued[entry] = 1;
+
+	// Each block's I only ever goes unseen, constant, unknown, so this
+	// settles after a few passes
+	while (!pending.empty())
+	{
+		size_t current = pending.back();
+		pending.pop_back();
+		queued[current] = 0;
+
+		BasicBlock const& block = blocks[current];
+		uint32_t exitIndex = Transfer(chip8, block, entryIndex[current], false);
+		bool call = (OpcodeAt(chip8, block.last) >> 12u) == 0x2;
+
+		for (unsigned int i = 0; i < 2 && block.successors[i] != BasicBlock::NO_SUCCESSOR; ++i)
+		{
+			// Whatever the subroutine did to I is lost by the return site
+			uint32_t index = call && i == 1 ? I_UNKNOWN : exitIndex;
+			size_t next = BlockAt(block.successors[i]);
+			uint32_t& nextIndex = entryIndex[next];
+			uint32_t merged = nextIndex == I_UNSEEN || nextIndex == index ? index : I_UNKNOWN;
+
+			if (merged != nextIndex)
+			{
+				nextIndex = merged;
+
+				if (!queued[next])
+				{
+					pending.push_back(next);
+					queued[next] = 1;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < blocks.size(); ++i)
+	{
+		if (entryIndex[i] != I_UNSEEN)
+		{
+			Transfer(chip8, blocks[i], entryIndex[i], true);
+		}
+	}
+}
+
+uint32_t RomAnalysis::Transfer(Chip8 const& chip8, BasicBlock const& block, uint32_t index, bool record)
+{
+	uint32_t quirks = chip8.Quirks();
+	uint16_t addressMask = AddressMaskOf(quirks);
+	bool incrementIndex = (quirks & QUIRK_INCREMENT_INDEX) != 0;
+
+	for (unsigned int address = block.start; address <= block.last;)
+	{
+		uint16_t opcode = OpcodeAt(chip8, address);
+		unsigned int x = (opcode >> 8u) & 0xFu;
+		unsigned int y = (opcode >> 4u) & 0xFu;
+		unsigned int n = opcode & 0xFu;
+		unsigned int kk = opcode & 0xFFu;
+		unsigned int range = (x > y ? x - y : y - x) + 1;
+		bool known = index != I_UNKNOWN;
+
+		if (!chip8.IsValid(opcode))
+		{
+			break;
+		}
+
+		if (IsLongLoad(chip8, opcode))
+		{
+			index = OpcodeAt(chip8, address + 2);
+			address += 4;
+			continue;
+		}
+
+		switch (opcode >> 12u)
+		{
+		case 0x5:
+		{
+			if ((quirks & QUIRK_XOCHIP) != 0 && n == 0x2 && record)
+			{
+				Store(index, range, addressMask);
+			}
+			else if ((quirks & QUIRK_XOCHIP) != 0 && n == 0x3 && record && known)
+			{
+				Mark(index, range, ByteKind::Data, addressMask);
+			}
+		}break;
+
+		case 0xA:
+		{
+			index = opcode & 0x0FFFu;
+		}break;
+
+		case 0xD:
+		{
+			// The rows of one plane, a 16x16 sprite is 32 bytes
+			unsigned int bytes = n != 0 ? n : (quirks & QUIRK_SCHIP) != 0 ? 32 : 0;
+
+			if (record && known)
+			{
+				Mark(index, bytes, ByteKind::Sprite, addressMask);
+			}
+		}break;
+
+		case 0xF:
+		{
+			switch (kk)
+			{
+			case 0x02:
+			{
+				if (record && known)
+				{
+					Mark(index, 16, ByteKind::Data, addressMask);
+				}
+			}break;
+
+			case 0x1E:
+			case 0x29:
+			case 0x30:
+			{
+				index = I_UNKNOWN;
+			}break;
+
+			case 0x33:
+			{
+				if (record)
+				{
+					Store(index, 3, addressMask);
+				}
+			}break;
+
+			case 0x55:
+			case 0x65:
+			{
+				if (record && kk == 0x55)
+				{
+					Store(index, x + 1, addressMask);
+				}
+				else if (record && known)
+				{
+					Mark(index, x + 1, ByteKind::Data, addressMask);
+				}
+
+				if (incrementIndex && known)
+				{
+					index = (index + x + 1) & addressMask;
+				}
+			}break;
+
+			default:
+				break;
+			}
+		}break;
+
+		default:
+			break;
+		}
+
+		address += 2;
+	}
+
+	return index;
+}
+
+void RomAnalysis::Mark(uint32_t index, unsigned int length, ByteKind kind, uint16_t addressMask)
+{
+	for (unsigned int i = 0; i < length; ++i)
+	{
+		ByteKind& byte = kinds[(index + i) & addressMask];
+
+		// Code stays code, and drawing it makes data a sprite
+		if (byte == ByteKind::Unknown || (byte == ByteKind::Data && kind == ByteKind::Sprite))
+		{
+			byte = kind;
+		}
+	}
+}
+
+void RomAnalysis::Store(uint32_t index, unsigned int length, uint16_t addressMask)
+{
+	if (index == I_UNKNOWN)
+	{
+		++untrackedWrites;
+		return;
+	}
+
+	for (unsigned int i = 0; i < length; ++i)
+	{
+		if (kinds[(index + i) & addressMask] == ByteKind::Code)
+		{
+			++codeWrites;
+			break;
+		}
+	}
+
+	Mark(index, length, ByteKind::Data, addressMask);
+}
+
+size_t RomAnalysis::Count(ByteKind kind) const
+{
+	return static_cast<size_t>(std::count(kinds.begin(), kinds.end(), kind));
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Instructions as Assembly			//
+//											//
+//////////////////////////////////////////////
+
+unsigned int Disassemble(Chip8 const& chip8, uint16_t address, char* text, size_t size)
+{
+	uint16_t opcode = OpcodeAt(chip8, address);
+	uint32_t quirks = chip8.Quirks();
+
+	unsigned int x = (opcode >> 8u) & 0xFu;
+	unsigned int y = (opcode >> 4u) & 0xFu;
+	unsigned int n = opcode & 0xFu;
+	unsigned int kk = opcode & 0xFFu;
+	unsigned int nnn = opcode & 0x0FFFu;
+
+	if (!chip8.IsValid(opcode))
+	{
+		std::snprintf(text, size, "DW 0x%04X", opcode);
+		return 2;
+	}
+
+	if (IsLongLoad(chip8, opcode))
+	{
+		std::snprintf(text, size, "LD I, 0x%04X", OpcodeAt(chip8, address + 2));
+		return 4;
+	}
+
+	static char const* const ALU[16] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN", "", "", "", "", "", "", "SHL", "" };
+
+	switch (opcode >> 12u)
+	{
+	case 0x0:
+	{
+		if ((quirks & QUIRK_SCHIP) == 0)
+		{
+			std::snprintf(text, size, "%s", n == 0xE ? "RET" : "CLS");
+		}
+		else if (y == 0xC || y == 0xD)
+		{
+			std::snprintf(text, size, "%s %u", y == 0xC ? "SCD" : "SCU", n);
+		}
+		else
+		{
+			static char const* const SYSTEM[] = { "CLS", "RET", "SCR", "SCL", "EXIT", "LOW", "HIGH" };
+			static const uint8_t OPCODES[] = { 0xE0, 0xEE, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF };
+
+			for (unsigned int i = 0; i < sizeof(OPCODES); ++i)
+			{
+				if (kk == OPCODES[i])
+				{
+					std::snprintf(text, size, "%s", SYSTEM[i]);
+				}
+			}
+		}
+	}break;
+
+	case 0x1: std::snprintf(text, size, "JP 0x%03X", nnn); break;
+	case 0x2: std::snprintf(text, size, "CALL 0x%03X", nnn); break;
+	case 0x3: std::snprintf(text, size, "SE V%X, 0x%02X", x, kk); break;
+	case 0x4: std::snprintf(text, size, "SNE V%X, 0x%02X", x, kk); break;
+
+	case 0x5:
+	{
+		if ((quirks & QUIRK_XOCHIP) != 0 && n != 0)
+		{
+			std::snprintf(text, size, "%s V%X - V%X", n == 0x2 ? "SAVE" : "LOAD", x, y);
+		}
+		else
+		{
+			std::snprintf(text, size, "SE V%X, V%X", x, y);
+		}
+	}break;
+
+	case 0x6: std::snprintf(text, size, "LD V%X, 0x%02X", x, kk); break;
+	case 0x7: std::snprintf(text, size, "ADD V%X, 0x%02X", x, kk); break;
+	case 0x8: std::snprintf(text, size, "%s V%X, V%X", ALU[n], x, y); break;
+	case 0x9: std::snprintf(text, size, "SNE V%X, V%X", x, y); break;
+	case 0xA: std::snprintf(text, size, "LD I, 0x%03X", nnn); break;
+
+	case 0xB:
+	{
+		if ((quirks & QUIRK_JUMP_VX) != 0)
+		{
+			std::snprintf(text, size, "JP V%X, 0x%03X", x, nnn);
+		}
+		else
+		{
+			std::snprintf(text, size, "JP V0, 0x%03X", nnn);
+		}
+	}break;
+
+	case 0xC: std::snprintf(text, size, "RND V%X, 0x%02X", x, kk); break;
+	case 0xD: std::snprintf(text, size, "DRW V%X, V%X, %u", x, y, n); break;
+	case 0xE: std::snprintf(text, size, "%s V%X", kk == 0x9E ? "SKP" : "SKNP", x); break;
+
+	case 0xF:
+	{
+		switch (kk)
+		{
+		case 0x01: std::snprintf(text, size, "PLANE %u", x); break;
+		case 0x02: std::snprintf(text, size, "AUDIO"); break;
+		case 0x07: std::snprintf(text, size, "LD V%X, DT", x); break;
+		case 0x0A: std::snprintf(text, size, "LD V%X, K", x); break;
+		case 0x15: std::snprintf(text, size, "LD DT, V%X", x); break;
+		case 0x18: std::snprintf(text, size, "LD ST, V%X", x); break;
+		case 0x1E: std::snprintf(text, size, "ADD I, V%X", x); break;
+		case 0x29: std::snprintf(text, size, "LD F, V%X", x); break;
+		case 0x30: std::snprintf(text, size, "LD HF, V%X", x); break;
+		case 0x33: std::snprintf(text, size, "LD B, V%X", x); break;
+		case 0x3A: std::snprintf(text, size, "PITCH V%X", x); break;
+		case 0x55: std::snprintf(text, size, "LD [I], V%X", x); break;
+		case 0x65: std::snprintf(text, size, "LD V%X, [I]", x); break;
+		case 0x75: std::snprintf(text, size, "LD R, V%X", x); break;
+		case 0x85: std::snprintf(text, size, "LD V%X, R", x); break;
+		default: break;
+		}
+	}break;
+	}
+
+	return 2;
+}
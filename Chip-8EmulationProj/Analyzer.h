@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What a byte of memory is to the code that can be reached
+enum class ByteKind : uint8_t
+{
+	Unknown,		// never fetched and never pointed at with a known I
+	Code,			// part of a reachable instruction
+	Sprite,			// drawn by Dxyn
+	Data			// read or written through I by anything else
+};
+
+// Instructions entered only at the top and left only at the bottom
+struct BasicBlock
+{
+	static constexpr uint16_t NO_SUCCESSOR = 0xFFFF;
+
+	uint16_t start;
+	uint16_t last;				// address of the last instruction
+	uint16_t end;				// address after it
+
+	// Where control can go next, NO_SUCCESSOR when unused. A call's are
+	// the subroutine and then the return site.
+	uint16_t successors[2];
+};
+
+// A 2nnn at site calling the subroutine at target
+struct CallEdge
+{
+	uint16_t site;
+	uint16_t target;
+};
+
+// Recovers the control flow graph of the program in a machine's memory
+// without running it. Jumps, calls, returns and both ways out of every
+// skip are followed from pc; a call is assumed to return. Bnnn depends on
+// a register, so code only reached through it is missed. I is tracked as
+// far as it is a constant, which is enough to tell sprites from other
+// data and to spot stores that land on code.
+class RomAnalysis
+{
+public:
+	void Analyze(Chip8 const& chip8);
+
+	// Sorted by start address
+	std::vector<BasicBlock> const& Blocks() const { return blocks; }
+	std::vector<CallEdge> const& Calls() const { return calls; }
+
+	// Where every block starts, for Chip8::WarmCodeCache
+	std::vector<uint16_t> const& BlockStarts() const { return blockStarts; }
+
+	ByteKind Kind(unsigned int address) const { return address < kinds.size() ? kinds[address] : ByteKind::Unknown; }
+	size_t Count(ByteKind kind) const;
+
+	unsigned int IndirectJumps() const { return indirectJumps; }
+
+	// Fx33, Fx55 and 5xy2 with a known I that overlaps code, and with an I
+	// that couldn't be worked out
+	unsigned int CodeWrites() const { return codeWrites; }
+	unsigned int UntrackedWrites() const { return untrackedWrites; }
+
+	// Writes over its own code, so the block cache and the JIT would keep
+	// throwing away what they built. Better run through Chip8::Interpret.
+	bool SelfModifying() const { return codeWrites > 0; }
+
+private:
+	// I on entry to a block: not reached yet, a constant, or anything
+	static constexpr uint32_t I_UNSEEN = 0x10000;
+	static constexpr uint32_t I_UNKNOWN = 0x10001;
+
+	void FindCode(Chip8 const& chip8);
+	void BuildBlocks(Chip8 const& chip8);
+	void TrackIndex(Chip8 const& chip8);
+
+	// Runs one block's instructions over I, marking what they touch when
+	// record is set. Returns I at the end of the block.
+	uint32_t Transfer(Chip8 const& chip8, BasicBlock const& block, uint32_t index, bool record);
+
+	void Mark(uint32_t index, unsigned int length, ByteKind kind, uint16_t addressMask);
+	void Store(uint32_t index, unsigned int length, uint16_t addressMask);
+	size_t BlockAt(uint16_t address) const;
+
+	std::vector<ByteKind> kinds;
+	std::vector<uint8_t> leaders;
+	std::vector<BasicBlock> blocks;
+	std::vector<CallEdge> calls;
+	std::vector<uint16_t> blockStarts;
+	std::vector<uint32_t> entryIndex;
+
+	unsigned int indirectJumps{};
+	unsigned int codeWrites{};
+	unsigned int untrackedWrites{};
+};
+
+// The instruction at address as assembly, like "LD V0, 0x12" or "DW 0x0123"
+// when the machine's profile has no such instruction. Returns how many
+// bytes it takes, 4 for XO-CHIP's F000 nnnn.
+unsigned int Disassemble(Chip8 const& chip8, uint16_t address, char* text, size_t size);
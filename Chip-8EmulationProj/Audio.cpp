@@ -0,0 +1,180 @@
+#include "Audio.h"
+#include <cmath>
+#include <cstring>
+
+
+//////////////////////////////////////////////
+//											//
+//		  Synthesize a Frame of Sound		//
+//											//
+//////////////////////////////////////////////
+
+void AudioSynth::Frame(Chip8 const& chip8)
+{
+	bool pattern = false;
+
+	if ((chip8.Quirks() & QUIRK_XOCHIP) != 0)
+	{
+		for (uint8_t byte : chip8.audioPattern)
+		{
+			pattern |= byte != 0;
+		}
+	}
+
+	if (chip8.soundTimer == 0)
+	{
+		std::memset(samples, 0, sizeof(samples));
+	}
+	else if (pattern)
+	{
+		// 4000 * 2 ^ ((pitch - 64) / 48) bits a second, 128 bits a turn
+		double bitsPerSecond = 4000.0 * std::exp2((chip8.pitch - 64.0) / 48.0);
+		uint32_t step = static_cast<uint32_t>(bitsPerSecond / 128.0 * 4294967296.0 / SAMPLE_RATE);
+
+		for (int16_t& sample : samples)
+		{
+			unsigned int bit = phase >> 25u;
+			bool high = ((chip8.audioPattern[bit >> 3u] >> (7u - (bit & 7u))) & 1u) != 0;
+
+			sample = high ? AMPLITUDE : -AMPLITUDE;
+			phase += step;
+		}
+	}
+	else
+	{
+		const uint32_t STEP = static_cast<uint32_t>(uint64_t(BEEP_HZ) * 4294967296ull / SAMPLE_RATE);
+
+		for (int16_t& sample : samples)
+		{
+			sample = (phase >> 31u) != 0 ? AMPLITUDE : -AMPLITUDE;
+			phase += STEP;
+		}
+	}
+
+	if (ring != nullptr && ring->Size() + SAMPLES_PER_FRAME <= maxQueued)
+	{
+		ring->Push(samples, SAMPLES_PER_FRAME);
+	}
+
+	if (wav != nullptr)
+	{
+		wav->Write(samples, SAMPLES_PER_FRAME);
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//			 Record to a WAV File			//
+//											//
+//////////////////////////////////////////////
+
+WavWriter::~WavWriter()
+{
+	if (file != nullptr)
+	{
+		Finish();
+	}
+}
+
+bool WavWriter::Open(char const* filename, uint32_t sampleRate)
+{
+	file = std::fopen(filename, "wb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	failed = false;
+	buffered = 0;
+	dataBytes = 0;
+
+	// The two sizes stay zero until Finish knows them
+	static const uint8_t RIFF[] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E' };
+	static const uint8_t FORMAT[] = { 'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0 };
+	static const uint8_t DATA[] = { 'd', 'a', 't', 'a', 0, 0, 0, 0 };
+
+	uint32_t byteRate = sampleRate * sizeof(int16_t);
+
+	for (uint8_t byte : RIFF) Put(byte);
+	for (uint8_t byte : FORMAT) Put(byte);
+	for (unsigned int i = 0; i < 4; ++i) Put(static_cast<uint8_t>(sampleRate >> (i * 8u)));
+	for (unsigned int i = 0; i < 4; ++i) Put(static_cast<uint8_t>(byteRate >> (i * 8u)));
+	Put(sizeof(int16_t));
+	Put(0);
+	Put(16);
+	Put(0);
+	for (uint8_t byte : DATA) Put(byte);
+
+	return true;
+}
+
+void WavWriter::Write(int16_t const* samples, size_t count)
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint16_t sample = static_cast<uint16_t>(samples[i]);
+
+		Put(static_cast<uint8_t>(sample));
+		Put(static_cast<uint8_t>(sample >> 8u));
+	}
+
+	dataBytes += static_cast<uint32_t>(count * sizeof(int16_t));
+}
+
+bool WavWriter::Finish()
+{
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	Flush();
+
+	// RIFF size at 4, data size at 40
+	uint32_t sizes[2] = { 36 + dataBytes, dataBytes };
+	long offsets[2] = { 4, 40 };
+
+	for (unsigned int i = 0; i < 2; ++i)
+	{
+		uint8_t bytes[4];
+
+		for (unsigned int b = 0; b < 4; ++b)
+		{
+			bytes[b] = static_cast<uint8_t>(sizes[i] >> (b * 8u));
+		}
+
+		failed |= std::fseek(file, offsets[i], SEEK_SET) != 0 || std::fwrite(bytes, 1, 4, file) != 4;
+	}
+
+	failed |= std::fclose(file) != 0;
+	file = nullptr;
+
+	return !failed;
+}
+
+void WavWriter::Put(uint8_t byte)
+{
+	if (buffered == BUFFER_SIZE)
+	{
+		Flush();
+	}
+
+	buffer[buffered++] = byte;
+}
+
+void WavWriter::Flush()
+{
+	if (buffered > 0 && std::fwrite(buffer, 1, buffered, file) != buffered)
+	{
+		failed = true;
+	}
+
+	buffered = 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Chip8.h"
+#include "Scheduler.h"
+#include "SpscQueue.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Samples from the emulation thread to the audio device's callback
+typedef SpscQueue<int16_t, 4096> SampleRing;
+
+// Writes mono 16-bit PCM to a WAV file, buffered like MovieWriter. The
+// header's sizes are filled in by Finish.
+class WavWriter
+{
+public:
+	WavWriter() = default;
+	~WavWriter();
+
+	WavWriter(WavWriter const&) = delete;
+	WavWriter& operator=(WavWriter const&) = delete;
+
+	bool Open(char const* filename, uint32_t sampleRate);
+	bool IsOpen() const { return file != nullptr; }
+
+	void Write(int16_t const* samples, size_t count);
+
+	// Patch the header and close. Returns false if any write failed.
+	bool Finish();
+
+private:
+	static constexpr size_t BUFFER_SIZE = 4096;
+
+	void Put(uint8_t byte);
+	void Flush();
+
+	std::FILE* file{};
+	bool failed{};
+	uint32_t dataBytes{};
+
+	uint8_t buffer[BUFFER_SIZE];
+	size_t buffered{};
+};
+
+// Turns the sound timer into samples, one frame's worth at the end of
+// every frame. A square wave beeps while the timer runs; on XO-CHIP the
+// 128-bit audio pattern loops at the pitch register's rate instead, unless
+// it is still all zeros. Samples go to a SampleRing, a WavWriter, both,
+// or nowhere, which still costs the synthesis.
+class AudioSynth
+{
+public:
+	static constexpr unsigned int SAMPLE_RATE = 48000;
+	static constexpr unsigned int SAMPLES_PER_FRAME = SAMPLE_RATE / Scheduler::TIMER_HZ;
+
+	// Frames are dropped rather than queue past maxQueued samples, so a
+	// machine running ahead of real time can't build up latency
+	void SetRing(SampleRing* ring, size_t maxQueued) { this->ring = ring; this->maxQueued = maxQueued; }
+	void SetWav(WavWriter* wav) { this->wav = wav; }
+
+	// Render the frame that is ending, before its timers tick
+	void Frame(Chip8 const& chip8);
+
+	// The last frame rendered
+	int16_t const* Samples() const { return samples; }
+
+private:
+	static constexpr unsigned int BEEP_HZ = 440;
+	static constexpr int16_t AMPLITUDE = 0x2000;
+
+	SampleRing* ring{};
+	size_t maxQueued{};
+	WavWriter* wav{};
+
+	// Where the wave is, a full turn of 2^32 is one beep cycle or one
+	// pass over the pattern
+	uint32_t phase{};
+
+	int16_t samples[SAMPLES_PER_FRAME]{};
+};
@@ -0,0 +1,193 @@
+#include "BatchRunner.h"
+#include "Lockstep.h"
+#include <cstring>
+
+
+char const* HaltReasonName(HaltReason reason)
+{
+	switch (reason)
+	{
+	case HaltReason::CycleLimit: return "cycle-limit";
+	case HaltReason::JumpToSelf: return "jump-to-self";
+	case HaltReason::WaitForKey: return "wait-for-key";
+	case HaltReason::Exit: return "exit";
+	case HaltReason::Fault: return "fault";
+	}
+
+	return "unknown";
+}
+
+char const* FaultName(Chip8Fault fault)
+{
+	switch (fault)
+	{
+	case Chip8Fault::None: return "none";
+	case Chip8Fault::InvalidOpcode: return "invalid-opcode";
+	case Chip8Fault::StackOverflow: return "stack-overflow";
+	case Chip8Fault::StackUnderflow: return "stack-underflow";
+	case Chip8Fault::Exit: return "exit";
+	}
+
+	return "unknown";
+}
+
+
+BatchRunner::BatchRunner(size_t capacity)
+{
+	// Never grows past this, so instances don't move once added
+	instances.reserve(capacity);
+	seeds.reserve(capacity);
+	halts.reserve(capacity);
+	cycles.reserve(capacity);
+	frames.reserve(capacity);
+	selfModifying.reserve(capacity);
+}
+
+bool BatchRunner::Add(uint8_t const* rom, size_t size, uint64_t seed)
+{
+	if (instances.size() == instances.capacity())
+	{
+		return false;
+	}
+
+	instances.emplace_back(seed);
+	instances.back().SetQuirkProfile(quirkProfile);
+
+	if (!instances.back().LoadROM(rom, size))
+	{
+		instances.pop_back();
+		return false;
+	}
+
+	// Copies of one ROM share the analysis of the first. Past 4 KB an
+	// XO-CHIP image carries on in the extended memory.
+	Chip8 const& analyzed = instances[analyzedInstance];
+	size_t low = size < MEMORY_SIZE - START_ADDRESS ? size : MEMORY_SIZE - START_ADDRESS;
+
+	if (instances.size() == 1 || size != analyzedSize || quirkProfile != analyzed.GetQuirkProfile()
+		|| std::memcmp(rom, &analyzed.memory[START_ADDRESS], low) != 0
+		|| (size > low && std::memcmp(rom + low, analyzed.ExtendedMemory(), size - low) != 0))
+	{
+		analyzedInstance = instances.size() - 1;
+		analyzedSize = size;
+		analysis.Analyze(instances.back());
+	}
+
+	instances.back().WarmCodeCache(analysis.BlockStarts());
+
+	seeds.push_back(seed);
+	halts.push_back(HaltReason::CycleLimit);
+	cycles.push_back(0);
+	frames.push_back(0);
+	selfModifying.push_back(analysis.SelfModifying());
+
+	return true;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Run Until a Halt Condition is Hit		//
+//											//
+//////////////////////////////////////////////
+
+HaltReason BatchRunner::RunToHalt(Chip8& chip8, Scheduler& scheduler, uint64_t maxCycles, uint64_t& cycles)
+{
+	const uint64_t CHUNK_CYCLES = 1u << 20;
+
+	for (cycles = 0; cycles < maxCycles;)
+	{
+		uint32_t chunk = static_cast<uint32_t>(maxCycles - cycles < CHUNK_CYCLES ? maxCycles - cycles : CHUNK_CYCLES);
+		uint32_t ran = scheduler.Run(chunk);
+
+		cycles += ran;
+
+		if (chip8.fault != Chip8Fault::None)
+		{
+			return HaltReasonOf(chip8.fault);
+		}
+
+		if (ran < chunk)
+		{
+			return chip8.WaitingForKey() ? HaltReason::WaitForKey : HaltReason::JumpToSelf;
+		}
+	}
+
+	return HaltReason::CycleLimit;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		  Spread Instances over Workers		//
+//											//
+//////////////////////////////////////////////
+
+void BatchRunner::Run(ThreadPool& pool)
+{
+	if (instances.empty())
+	{
+		return;
+	}
+
+	if (lockstep)
+	{
+		size_t groups = (instances.size() + Lockstep::LANES - 1) / Lockstep::LANES;
+
+		pool.ParallelFor(groups, [this](size_t group, unsigned int)
+		{
+			RunGroup(group);
+		});
+
+		return;
+	}
+
+	// Detached until a worker attaches its own instance, so no two workers
+	// ever touch the same machine's blocks
+	while (useJit && jits.size() < pool.Threads())
+	{
+		jits.emplace_back(new Jit());
+	}
+
+	pool.ParallelFor(instances.size(), [this](size_t i, unsigned int worker)
+	{
+		RunInstance(i, worker);
+	});
+}
+
+void BatchRunner::RunInstance(size_t i, unsigned int worker)
+{
+	Chip8& chip8 = instances[i];
+	Jit* jit = nullptr;
+
+	if (useJit)
+	{
+		jit = jits[worker].get();
+		jit->Attach(chip8);
+	}
+
+	Scheduler scheduler(chip8, jit);
+	scheduler.SetInstructionsPerFrame(instructionsPerFrame);
+	scheduler.SetMode(Scheduler::Mode::Unthrottled);
+	scheduler.SetUncached(selfModifying[i] != 0);
+
+	halts[i] = RunToHalt(chip8, scheduler, maxCycles, cycles[i]);
+	frames[i] = scheduler.Frames();
+}
+
+void BatchRunner::RunGroup(size_t group)
+{
+	size_t first = group * Lockstep::LANES;
+	size_t count = instances.size() - first < Lockstep::LANES ? instances.size() - first : Lockstep::LANES;
+
+	Lockstep lanes(&instances[first], static_cast<unsigned int>(count));
+	lanes.SetInstructionsPerFrame(instructionsPerFrame);
+	lanes.Run(maxCycles);
+
+	for (unsigned int lane = 0; lane < count; ++lane)
+	{
+		halts[first + lane] = lanes.Halt(lane);
+		cycles[first + lane] = lanes.Cycles(lane);
+		frames[first + lane] = lanes.Frames(lane);
+	}
+}
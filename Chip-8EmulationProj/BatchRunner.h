@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Analyzer.h"
+#include "Chip8.h"
+#include "Jit.h"
+#include "Scheduler.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+char const* HaltReasonName(HaltReason reason);
+char const* FaultName(Chip8Fault fault);
+
+// Runs many independent machines to a halt across a ThreadPool. The
+// machines sit back to back in one allocation made up front, and what is
+// known about each one (seed, why it stopped, how far it got) is kept in
+// parallel arrays indexed by instance.
+class BatchRunner
+{
+public:
+	explicit BatchRunner(size_t capacity);
+
+	BatchRunner(BatchRunner const&) = delete;
+	BatchRunner& operator=(BatchRunner const&) = delete;
+
+	// Returns false when the batch is full or the ROM doesn't fit. The
+	// ROM is analyzed to warm the instance's code cache, once for a run
+	// of Adds with the same data.
+	bool Add(uint8_t const* rom, size_t size, uint64_t seed);
+
+	void SetMaxCycles(uint64_t cycles) { maxCycles = cycles; }
+	void SetInstructionsPerFrame(uint32_t count) { instructionsPerFrame = count; }
+	void SetUseJit(bool enabled) { useJit = enabled; }
+
+	// Applies to instances added afterwards
+	void SetQuirkProfile(QuirkProfile profile) { quirkProfile = profile; }
+
+	// Run neighbouring instances Lockstep::LANES at a time in vector lanes
+	// instead of one by one. Takes precedence over the JIT.
+	void SetLockstep(bool enabled) { lockstep = enabled; }
+
+	// Run every instance until it halts, each one on a single worker
+	void Run(ThreadPool& pool);
+
+	size_t Count() const { return instances.size(); }
+
+	Chip8& Instance(size_t i) { return instances[i]; }
+	Chip8 const& Instance(size_t i) const { return instances[i]; }
+	uint64_t Seed(size_t i) const { return seeds[i]; }
+	HaltReason Halt(size_t i) const { return halts[i]; }
+	uint64_t Cycles(size_t i) const { return cycles[i]; }
+	uint64_t Frames(size_t i) const { return frames[i]; }
+
+	// Found writing over its own code, so run through Chip8::Interpret
+	bool SelfModifying(size_t i) const { return selfModifying[i] != 0; }
+
+	// What Run does for each instance
+	static HaltReason RunToHalt(Chip8& chip8, Scheduler& scheduler, uint64_t maxCycles, uint64_t& cycles);
+
+private:
+	void RunInstance(size_t i, unsigned int worker);
+	void RunGroup(size_t group);
+
+	uint64_t maxCycles{ 1000000 };
+	uint32_t instructionsPerFrame{ 10 };
+	bool useJit{};
+	bool lockstep{};
+	QuirkProfile quirkProfile{ QuirkProfile::Default };
+
+	std::vector<Chip8> instances;
+	std::vector<uint64_t> seeds;
+	std::vector<HaltReason> halts;
+	std::vector<uint64_t> cycles;
+	std::vector<uint64_t> frames;
+	std::vector<uint8_t> selfModifying;
+
+	// What the instance last analyzed turned out to hold
+	RomAnalysis analysis;
+	size_t analyzedInstance{};
+	size_t analyzedSize{};
+
+	// One per worker, declared after the instances so their translations
+	// are dropped while the machines still exist
+	std::vector<std::unique_ptr<Jit>> jits;
+};
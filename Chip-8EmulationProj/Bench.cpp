@@ -0,0 +1,470 @@
+#include "Audio.h"
+#include "Chip8.h"
+#include "Jit.h"
+#include "Rom.h"
+#include "Scaler.h"
+#include "Scheduler.h"
+#include "VideoFile.h"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Microbenchmarks for the core's hot paths. Run with
+// --benchmark_format=json (or --benchmark_out=FILE) for results that can
+// be compared between builds.
+
+
+//////////////////////////////////////////////
+//											//
+//			   Synthetic ROMs				//
+//											//
+//////////////////////////////////////////////
+
+// Where sprite data and memory transfers point, clear of any ROM code
+const uint16_t DATA_ADDRESS = 0x800;
+
+static void Put(std::vector<uint8_t>& rom, uint16_t opcode)
+{
+	rom.push_back(static_cast<uint8_t>(opcode >> 8u));
+	rom.push_back(static_cast<uint8_t>(opcode));
+}
+
+// opcode copies times, then a jump back to the start
+static std::vector<uint8_t> RepeatROM(uint16_t opcode, unsigned int copies)
+{
+	std::vector<uint8_t> rom;
+
+	for (unsigned int i = 0; i < copies; ++i)
+	{
+		Put(rom, opcode);
+	}
+
+	Put(rom, 0x1000u | START_ADDRESS);
+
+	return rom;
+}
+
+// Register arithmetic and skips, the bulk of most game logic
+static std::vector<uint8_t> AluROM()
+{
+	std::vector<uint8_t> rom;
+
+	Put(rom, 0x6001);	// LD V0, 1
+	Put(rom, 0x6103);	// LD V1, 3
+	Put(rom, 0x7201);	// loop: ADD V2, 1
+	Put(rom, 0x8314);	// ADD V3, V1
+	Put(rom, 0x8405);	// SUB V4, V0
+	Put(rom, 0x8532);	// AND V5, V3
+	Put(rom, 0x8643);	// XOR V6, V4
+	Put(rom, 0x8706);	// SHR V7
+	Put(rom, 0x3200);	// SE V2, 0
+	Put(rom, 0x1204);	// JP loop
+	Put(rom, 0x1204);	// JP loop
+
+	return rom;
+}
+
+// Clears and redraws a row of font glyphs every pass
+static std::vector<uint8_t> DrawROM()
+{
+	std::vector<uint8_t> rom;
+
+	Put(rom, 0x00E0);	// loop: CLS
+	Put(rom, 0x6000);	// LD V0, 0
+	Put(rom, 0x6108);	// LD V1, 8
+	Put(rom, 0x6200);	// LD V2, 0
+	Put(rom, 0xF229);	// glyph: LD F, V2
+	Put(rom, 0xD015);	// DRW V0, V1, 5
+	Put(rom, 0x7005);	// ADD V0, 5
+	Put(rom, 0x7201);	// ADD V2, 1
+	Put(rom, 0x320C);	// SE V2, 12
+	Put(rom, 0x1208);	// JP glyph
+	Put(rom, 0x1200);	// JP loop
+
+	return rom;
+}
+
+// Random numbers turned into digits through memory, with a subroutine
+static std::vector<uint8_t> MemoryROM()
+{
+	std::vector<uint8_t> rom;
+
+	Put(rom, 0xA000 | DATA_ADDRESS);	// loop: LD I, data
+	Put(rom, 0xC0FF);	// RND V0, 255
+	Put(rom, 0xF033);	// LD B, V0
+	Put(rom, 0xF265);	// LD V2, [I]
+	Put(rom, 0x220E);	// CALL sum
+	Put(rom, 0xF255);	// LD [I], V2
+	Put(rom, 0x1200);	// JP loop
+	Put(rom, 0x8014);	// sum: ADD V0, V1
+	Put(rom, 0x8024);	// ADD V0, V2
+	Put(rom, 0x00EE);	// RET
+
+	return rom;
+}
+
+static void Load(Chip8& chip8, std::vector<uint8_t> const& rom)
+{
+	chip8.LoadROM(rom.data(), rom.size());
+
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		chip8.memory[DATA_ADDRESS + i] = static_cast<uint8_t>(0xA5u ^ (i * 0x11u));
+	}
+
+	chip8.index = DATA_ADDRESS;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Decode and Dispatch				//
+//											//
+//////////////////////////////////////////////
+
+// Arg is the opcode, picking which table the decode goes through
+static void BM_Decode(benchmark::State& state)
+{
+	Chip8 chip8{ 1 };
+	uint16_t opcode = static_cast<uint16_t>(state.range(0));
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(chip8.Decode(opcode));
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Decode)
+	->Arg(0x6123)	// table
+	->Arg(0x00E0)	// table0
+	->Arg(0x8124)	// table8
+	->Arg(0xE19E)	// tableE
+	->Arg(0xF133);	// tableF
+
+// Fetch, decode and dispatch of a register-only instruction through Cycle
+static void BM_CycleDispatch(benchmark::State& state)
+{
+	Chip8 chip8{ 1 };
+	Load(chip8, RepeatROM(static_cast<uint16_t>(state.range(0)), 64));
+
+	for (auto _ : state)
+	{
+		chip8.Cycle();
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CycleDispatch)->Arg(0x7101)->Arg(0x8124)->Arg(0xF11E);
+
+
+//////////////////////////////////////////////
+//											//
+//		  Single Instruction Handlers		//
+//											//
+//////////////////////////////////////////////
+
+// 64 copies of opcode run through the block cache, reported per instruction
+static void RunRepeated(benchmark::State& state, uint16_t opcode, uint8_t v0, uint8_t v1)
+{
+	Chip8 chip8{ 1 };
+	Load(chip8, RepeatROM(opcode, 64));
+
+	const uint32_t CYCLES = 65 * 16;
+
+	for (auto _ : state)
+	{
+		chip8.registers[0] = v0;
+		chip8.registers[1] = v1;
+		chip8.index = DATA_ADDRESS;
+
+		benchmark::DoNotOptimize(chip8.Run(CYCLES));
+	}
+
+	state.SetItemsProcessed(state.iterations() * CYCLES);
+}
+
+// Args are height, x and y
+static void BM_Draw(benchmark::State& state)
+{
+	uint16_t opcode = static_cast<uint16_t>(0xD010u | state.range(0));
+
+	RunRepeated(state, opcode, static_cast<uint8_t>(state.range(1)), static_cast<uint8_t>(state.range(2)));
+}
+BENCHMARK(BM_Draw)
+	->ArgNames({ "height", "x", "y" })
+	->Args({ 1, 0, 0 })
+	->Args({ 5, 0, 0 })
+	->Args({ 15, 0, 0 })
+	->Args({ 5, 3, 10 })		// straddles two bytes
+	->Args({ 15, 61, 10 })		// clipped at the right edge
+	->Args({ 15, 20, 28 });		// clipped at the bottom
+
+static void BM_Clear(benchmark::State& state)
+{
+	RunRepeated(state, 0x00E0, 0, 0);
+}
+BENCHMARK(BM_Clear);
+
+static void BM_StoreBcd(benchmark::State& state)
+{
+	RunRepeated(state, 0xF033, 0xC7, 0);
+}
+BENCHMARK(BM_StoreBcd);
+
+// Arg is the last register transferred
+static void BM_StoreRegisters(benchmark::State& state)
+{
+	RunRepeated(state, static_cast<uint16_t>(0xF055u | (state.range(0) << 8u)), 0, 0);
+}
+BENCHMARK(BM_StoreRegisters)->Arg(0)->Arg(7)->Arg(15);
+
+static void BM_LoadRegisters(benchmark::State& state)
+{
+	RunRepeated(state, static_cast<uint16_t>(0xF065u | (state.range(0) << 8u)), 0, 0);
+}
+BENCHMARK(BM_LoadRegisters)->Arg(0)->Arg(7)->Arg(15);
+
+
+//////////////////////////////////////////////
+//											//
+//			   Loading ROMs					//
+//											//
+//////////////////////////////////////////////
+
+// Args are the ROM size in bytes and the QuirkProfile, only XO-CHIP takes
+// ROMs past 4 KB
+static void BM_LoadROM(benchmark::State& state)
+{
+	Chip8 chip8{ 1 };
+	chip8.SetQuirkProfile(static_cast<QuirkProfile>(state.range(1)));
+	std::vector<uint8_t> rom(static_cast<size_t>(state.range(0)), 0x12);
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(chip8.LoadROM(rom.data(), rom.size()));
+	}
+
+	state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadROM)
+	->ArgNames({ "size", "quirks" })
+	->Args({ 256, static_cast<int64_t>(QuirkProfile::Default) })
+	->Args({ 4096 - START_ADDRESS, static_cast<int64_t>(QuirkProfile::Default) })
+	->Args({ XO_MEMORY_SIZE - START_ADDRESS, static_cast<int64_t>(QuirkProfile::XoChip) });
+
+// By filename, the mapping stays cached after the first iteration
+static void BM_LoadROMFile(benchmark::State& state)
+{
+	char const* filename = "chip8-bench.ch8";
+	std::vector<uint8_t> rom(4096 - START_ADDRESS, 0x12);
+
+	std::FILE* file = std::fopen(filename, "wb");
+	bool written = file != nullptr && std::fwrite(rom.data(), 1, rom.size(), file) == rom.size();
+
+	if (file == nullptr || std::fclose(file) != 0 || !written)
+	{
+		state.SkipWithError("could not write the ROM file");
+		return;
+	}
+
+	// Holding an image keeps it in the cache between iterations
+	std::shared_ptr<RomImage const> image = OpenROM(filename);
+	Chip8 chip8{ 1 };
+
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(chip8.LoadROM(filename));
+	}
+
+	std::remove(filename);
+
+	state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(rom.size()));
+}
+BENCHMARK(BM_LoadROMFile);
+
+
+//////////////////////////////////////////////
+//											//
+//			 Whole Frame Throughput			//
+//											//
+//////////////////////////////////////////////
+
+// Args are the ROM and whether to JIT, one iteration is one frame of
+// 1000 instructions
+static void BM_Frame(benchmark::State& state)
+{
+	static std::vector<uint8_t> (*const ROMS[])() = { &AluROM, &DrawROM, &MemoryROM };
+	static char const* const NAMES[] = { "alu", "draw", "memory" };
+
+	const uint32_t INSTRUCTIONS_PER_FRAME = 1000;
+
+	Chip8 chip8{ 1 };
+	Load(chip8, ROMS[state.range(0)]());
+
+	std::unique_ptr<Jit> jit(state.range(1) != 0 ? new Jit(chip8) : nullptr);
+
+	Scheduler scheduler(chip8, jit.get());
+	scheduler.SetInstructionsPerFrame(INSTRUCTIONS_PER_FRAME);
+
+	for (auto _ : state)
+	{
+		scheduler.RunFrames(1);
+	}
+
+	if (chip8.fault != Chip8Fault::None)
+	{
+		state.SkipWithError("ROM faulted");
+	}
+
+	state.SetLabel(NAMES[state.range(0)]);
+	state.SetItemsProcessed(static_cast<int64_t>(scheduler.Cycles()));
+}
+BENCHMARK(BM_Frame)
+	->ArgNames({ "rom", "jit" })
+	->ArgsProduct({ { 0, 1, 2 }, { 0, 1 } });
+
+
+//////////////////////////////////////////////
+//											//
+//			   Sound Synthesis				//
+//											//
+//////////////////////////////////////////////
+
+// One frame of samples with the sound timer running and nowhere for them
+// to go. Arg picks the beep (0) or an XO-CHIP pattern (1).
+static void BM_AudioFrame(benchmark::State& state)
+{
+	Chip8 chip8{ 1 };
+	AudioSynth audio;
+
+	if (state.range(0) != 0)
+	{
+		chip8.SetQuirkProfile(QuirkProfile::XoChip);
+		std::memset(chip8.audioPattern, 0xCC, sizeof(chip8.audioPattern));
+	}
+
+	chip8.soundTimer = 1;
+
+	for (auto _ : state)
+	{
+		audio.Frame(chip8);
+		benchmark::DoNotOptimize(audio.Samples());
+	}
+
+	state.SetItemsProcessed(state.iterations() * AudioSynth::SAMPLES_PER_FRAME);
+}
+BENCHMARK(BM_AudioFrame)->Arg(0)->Arg(1);
+
+
+//////////////////////////////////////////////
+//											//
+//			   Scaling to Texels			//
+//											//
+//////////////////////////////////////////////
+
+// A whole noisy high resolution frame into a texture. Args are the scale
+// and the filter, ExpandVideo's 1:1 loop is the baseline.
+static void BM_ExpandVideo(benchmark::State& state)
+{
+	static VideoPlanes video;
+	std::vector<uint32_t> pixels(VIDEO_WIDTH * VIDEO_HEIGHT);
+
+	for (unsigned int i = 0; i < sizeof(video) / sizeof(uint64_t); ++i)
+	{
+		(&video[0][0][0])[i] = 0x9E3779B97F4A7C15ull * (i + 1);
+	}
+
+	for (auto _ : state)
+	{
+		ExpandVideo(video, true, pixels.data());
+		benchmark::DoNotOptimize(pixels.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * VIDEO_WIDTH * VIDEO_HEIGHT);
+}
+BENCHMARK(BM_ExpandVideo);
+
+static void BM_Scale(benchmark::State& state)
+{
+	static VideoPlanes video;
+
+	for (unsigned int i = 0; i < sizeof(video) / sizeof(uint64_t); ++i)
+	{
+		(&video[0][0][0])[i] = 0x9E3779B97F4A7C15ull * (i + 1);
+	}
+
+	VideoScaler scaler;
+	scaler.SetScale(static_cast<unsigned int>(state.range(0)));
+	scaler.SetFilter(static_cast<ScaleFilter>(state.range(1)));
+
+	std::vector<uint32_t> texels(scaler.Width() * scaler.Height());
+
+	for (auto _ : state)
+	{
+		scaler.Expand(video, true, 0, VIDEO_HEIGHT, texels.data(), static_cast<int>(scaler.Width() * sizeof(uint32_t)));
+		benchmark::DoNotOptimize(texels.data());
+	}
+
+	state.SetLabel(ScaleFilterName(scaler.Filter()));
+	state.SetItemsProcessed(state.iterations() * texels.size());
+}
+BENCHMARK(BM_Scale)
+	->ArgNames({ "scale", "filter" })
+	->ArgsProduct({ { 1, 2, 4, 8 }, { 0, 1, 2 } });
+
+
+//////////////////////////////////////////////
+//											//
+//			   Recording Frames				//
+//											//
+//////////////////////////////////////////////
+
+// One frame into a video file, told which rows were drawn to as the
+// scheduler does. Arg 0 repeats the frame before, 1 changes a sprite's
+// worth of rows in it like a typical draw.
+static void BM_VideoFrame(benchmark::State& state)
+{
+	char const* filename = "chip8-bench.c8vd";
+	static VideoPlanes video;
+	VideoWriter writer;
+
+	if (!writer.Open(filename))
+	{
+		state.SkipWithError("could not create the video file");
+		return;
+	}
+
+	uint64_t random = 1;
+
+	for (auto _ : state)
+	{
+		uint64_t drawn = 0;
+
+		if (state.range(0) != 0)
+		{
+			random = random * 6364136223846793005ull + 1442695040888963407ull;
+			unsigned int y = static_cast<unsigned int>(random >> 32) % (VIDEO_HEIGHT - 5);
+
+			for (unsigned int row = 0; row < 5; ++row)
+			{
+				video[0][0][y + row] ^= 0xFFull << ((random >> 16) % 57);
+			}
+
+			drawn = 0x1Full << y;
+		}
+
+		writer.Frame(video, false, drawn);
+	}
+
+	state.counters["bytes_per_frame"] = static_cast<double>(writer.Bytes()) / state.iterations();
+
+	writer.Finish();
+	std::remove(filename);
+}
+BENCHMARK(BM_VideoFrame)->Arg(0)->Arg(1);
+
+
+BENCHMARK_MAIN();
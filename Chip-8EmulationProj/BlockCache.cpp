@@ -0,0 +1,234 @@
+#include "Chip8.h"
+#include "Profiler.h"
+
+
+// Instructions that can move pc anywhere but pc + 2, write memory that may
+// hold code, or fault must be the last one in their block. RET and EXIT
+// sit among the 00xx scrolls, which don't need to end one.
+bool Chip8::EndsBlock(Instruction const& ins)
+{
+	if (ins.handler == &Chip8::OP_NULL)
+	{
+		return true;
+	}
+
+	switch ((ins.opcode & 0xF000u) >> 12u)
+	{
+	case 0x0: return ins.n == 0xE || ins.kk == 0xFD;
+	case 0x1:
+	case 0x2:
+	case 0x3:
+	case 0x4:
+	case 0x5:
+	case 0x9:
+	case 0xB:
+	case 0xE: return true;
+	case 0xF: return ins.kk == 0x00 || ins.kk == 0x0A || ins.kk == 0x33 || ins.kk == 0x55;
+	default: return false;
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Decode a Basic Block Starting at pc	//
+//											//
+//////////////////////////////////////////////
+
+Chip8::Block const& Chip8::BuildBlock(uint16_t address)
+{
+	// Drop everything once the cache has been churned by self-modifying code
+	if (blocks.size() >= NO_BLOCK || blockCode.size() >= (1u << 20))
+	{
+		FlushCodeCache();
+	}
+
+	if (blockLookup.empty())
+	{
+		blockLookup.assign(CODE_SIZE, NO_BLOCK);
+	}
+
+	Block block;
+	block.first = static_cast<uint32_t>(blockCode.size());
+	block.start = address;
+	block.count = 0;
+	block.native = NO_NATIVE;
+
+	uint16_t pcAddress = address;
+
+	for (;;)
+	{
+		uint16_t opcode = (memory[pcAddress] << 8u) | memory[(pcAddress + 1) & 0x0FFFu];
+
+		// A jump to itself gets a block of its own, which never runs
+		if (block.count > 0 && IsJumpToSelf(opcode, pcAddress))
+		{
+			break;
+		}
+
+		Instruction ins = Decode(opcode);
+
+		blockCode.push_back(ins);
+		++block.count;
+
+		// Remember which pages hold code so data writes can skip invalidation
+		codePages |= 1ull << (pcAddress >> CODE_PAGE_SHIFT);
+		codePages |= 1ull << (((pcAddress + 1) & 0x0FFFu) >> CODE_PAGE_SHIFT);
+
+		pcAddress += 2;
+
+		if (EndsBlock(ins)
+			|| block.count == MAX_BLOCK_LENGTH
+			|| pcAddress > 0x0FFEu)
+		{
+			break;
+		}
+	}
+
+	blockLookup[address] = static_cast<uint16_t>(blocks.size());
+	blocks.push_back(block);
+
+	return blocks.back();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	 Drop Blocks Overlapping Written Memory	//
+//											//
+//////////////////////////////////////////////
+
+void Chip8::InvalidateCode(uint16_t address, unsigned int length)
+{
+	uint16_t addressMask = AddressMask();
+	uint64_t written = 0;
+
+	// XO-CHIP writes above the first 4 KB never land on code
+	for (unsigned int i = 0; i < length; ++i)
+	{
+		unsigned int at = (address + i) & addressMask;
+		written |= at < CODE_SIZE ? 1ull << (at >> CODE_PAGE_SHIFT) : 0;
+	}
+
+	// Plain data writes never touch a page we decoded from
+	if ((written & codePages) == 0)
+	{
+		return;
+	}
+
+	for (Block const& block : blocks)
+	{
+		if (blockLookup[block.start] == NO_BLOCK)
+		{
+			continue;
+		}
+
+		for (unsigned int i = 0; i < length; ++i)
+		{
+			unsigned int at = (address + i) & addressMask;
+			unsigned int offset = (at - block.start) & 0x0FFFu;
+
+			if (at < CODE_SIZE && offset < block.count * 2u)
+			{
+				blockLookup[block.start] = NO_BLOCK;
+				break;
+			}
+		}
+	}
+}
+
+void Chip8::FlushCodeCache()
+{
+	blockCode.clear();
+	blocks.clear();
+	blockLookup.clear();
+	codePages = 0;
+}
+
+void Chip8::WarmCodeCache(std::vector<uint16_t> const& addresses)
+{
+	for (uint16_t address : addresses)
+	{
+		address &= 0x0FFFu;
+
+		if (blockLookup.empty() || blockLookup[address] == NO_BLOCK)
+		{
+			BuildBlock(address);
+		}
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Execute Through the Basic Block Cache	//
+//											//
+//////////////////////////////////////////////
+
+uint32_t Chip8::Run(uint32_t maxCycles)
+{
+	// A faulted machine stays put, and parked in LD Vx, K costs nothing
+	// until a key is down
+	if (fault != Chip8Fault::None || !TryResume())
+	{
+		return 0;
+	}
+
+	if constexpr (PROFILING_ENABLED)
+	{
+		if (profiler != nullptr)
+		{
+			return RunBlocks<true>(maxCycles);
+		}
+	}
+
+	return RunBlocks<false>(maxCycles);
+}
+
+template <bool PROFILED>
+uint32_t Chip8::RunBlocks(uint32_t maxCycles)
+{
+	uint32_t executed = 0;
+
+	while (executed < maxCycles)
+	{
+		pc &= 0x0FFFu;
+
+		uint16_t blockIndex = blockLookup.empty() ? NO_BLOCK : blockLookup[pc];
+		Block const& block = blockIndex != NO_BLOCK ? blocks[blockIndex] : BuildBlock(pc);
+
+		// Copy out what we need, the last instruction may invalidate the block
+		Instruction const* code = &blockCode[block.first];
+		uint32_t count = block.count;
+
+		if (IsJumpToSelf(code[0].opcode, block.start))
+		{
+			break;
+		}
+
+		if (count > maxCycles - executed)
+		{
+			count = maxCycles - executed;
+		}
+
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if constexpr (PROFILED)
+			{
+				profiler->Instruction(pc, code[i].opcode);
+			}
+
+			pc += 2;
+			((*this).*(code[i].handler))(code[i]);
+		}
+
+		executed += count;
+
+		if (fault != Chip8Fault::None || waitingForKey)
+		{
+			break;
+		}
+	}
+
+	return executed;
+}
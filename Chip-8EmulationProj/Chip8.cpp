@@ -0,0 +1,1664 @@
+#include "Chip8.h"
+#include "Profiler.h"
+#include "Rom.h"
+#include <chrono>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define CHIP8_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHIP8_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+const uint8_t fontset[FONTSET_SIZE] =
+{
+	0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+	0x20, 0x60, 0x20, 0x20, 0x70, // 1
+	0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+	0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+	0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+	0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+	0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+	0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+	0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+	0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+	0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+	0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+	0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+	0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+	0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+	0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+const uint8_t largeFontset[LARGE_FONTSET_SIZE] =
+{
+	0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+	0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+	0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+	0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+	0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+	0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+	0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+	0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+	0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+	0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+	0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+
+//////////////////////////////////////////////
+//											//
+//		 Initialize PC, Fonts and RNG		// 
+//											//
+//////////////////////////////////////////////
+
+Chip8::Chip8()
+{
+	pc = START_ADDRESS;
+	Seed(static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+
+	// Load Fonts into Memory
+	for (unsigned int i = 0; i < FONTSET_SIZE; ++i)
+	{
+		memory[FONTSET_START_ADDRESS + i] = fontset[i];
+	}
+
+	std::memcpy(&memory[LARGE_FONTSET_START_ADDRESS], largeFontset, LARGE_FONTSET_SIZE);
+}
+
+Chip8::Chip8(uint64_t seed)
+	: Chip8()
+{
+	Seed(seed);
+}
+
+void Chip8::Seed(uint64_t seed)
+{
+	randState = SplitMix64(seed);
+
+	// xorshift gets stuck on zero
+	if (randState == 0)
+	{
+		randState = 1;
+	}
+
+	randBits = 0;
+	randBytesLeft = 0;
+}
+
+void Chip8::SetRandomSource(RandomFunc source)
+{
+	randomSource = source != nullptr ? source : &XorShift64Star;
+	randBytesLeft = 0;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	 Opcode Tables, Built Once per Process	// 
+//											//
+//////////////////////////////////////////////
+
+Chip8::DispatchTables const& Chip8::Dispatch(QuirkProfile profile)
+{
+	// In QuirkProfile order
+	static const DispatchTables tables[QUIRK_PROFILE_COUNT] =
+	{
+		BuildDispatchTables<QuirksOf(QuirkProfile::Default)>(),
+		BuildDispatchTables<QuirksOf(QuirkProfile::CosmacVip)>(),
+		BuildDispatchTables<QuirksOf(QuirkProfile::SuperChip)>(),
+		BuildDispatchTables<QuirksOf(QuirkProfile::XoChip)>()
+	};
+
+	return tables[static_cast<unsigned int>(profile) < QUIRK_PROFILE_COUNT ? static_cast<unsigned int>(profile) : 0];
+}
+
+template <uint32_t QUIRKS>
+Chip8::DispatchTables Chip8::BuildDispatchTables()
+{
+	DispatchTables tables;
+
+	constexpr bool SCHIP = (QUIRKS & QUIRK_SCHIP) != 0;
+	constexpr bool XOCHIP = (QUIRKS & QUIRK_XOCHIP) != 0;
+
+	// Prefixes 0, 5, 8, E and F are resolved through their own tables in Decode
+	tables.table[0x0] = &Chip8::OP_NULL;
+	tables.table[0x1] = &Chip8::OP_1nnn;
+	tables.table[0x2] = &Chip8::OP_2nnn;
+	tables.table[0x3] = &Chip8::OP_3xkk<QUIRKS>;
+	tables.table[0x4] = &Chip8::OP_4xkk<QUIRKS>;
+	tables.table[0x5] = &Chip8::OP_NULL;
+	tables.table[0x6] = &Chip8::OP_6xkk;
+	tables.table[0x7] = &Chip8::OP_7xkk;
+	tables.table[0x8] = &Chip8::OP_NULL;
+	tables.table[0x9] = &Chip8::OP_9xy0<QUIRKS>;
+	tables.table[0xA] = &Chip8::OP_Annn;
+	tables.table[0xB] = &Chip8::OP_Bnnn<QUIRKS>;
+	tables.table[0xC] = &Chip8::OP_Cxkk;
+	tables.table[0xD] = &Chip8::OP_Dxyn<QUIRKS>;
+	tables.table[0xE] = &Chip8::OP_NULL;
+	tables.table[0xF] = &Chip8::OP_NULL;
+
+	// Without the extensions only the low nibble picks CLS or RET, and
+	// 5xyn ignores n
+	for (size_t i = 0; i <= 0xFF; i++)
+	{
+		tables.table0[i] = SCHIP ? &Chip8::OP_NULL
+			: (i & 0xFu) == 0x0 ? &Chip8::OP_00E0<QUIRKS>
+			: (i & 0xFu) == 0xE ? &Chip8::OP_00EE
+			: &Chip8::OP_NULL;
+		tables.tableF[i] = &Chip8::OP_NULL;
+	}
+
+	for (size_t i = 0; i <= 0xF; i++)
+	{
+		tables.table5[i] = XOCHIP ? &Chip8::OP_NULL : &Chip8::OP_5xy0<QUIRKS>;
+		tables.table8[i] = &Chip8::OP_NULL;
+		tables.tableE[i] = &Chip8::OP_NULL;
+	}
+
+	if constexpr (SCHIP)
+	{
+		tables.table0[0xE0] = &Chip8::OP_00E0<QUIRKS>;
+		tables.table0[0xEE] = &Chip8::OP_00EE;
+		tables.table0[0xFB] = &Chip8::OP_00FB;
+		tables.table0[0xFC] = &Chip8::OP_00FC;
+		tables.table0[0xFD] = &Chip8::OP_00FD;
+		tables.table0[0xFE] = &Chip8::OP_00FE;
+		tables.table0[0xFF] = &Chip8::OP_00FF;
+
+		for (size_t i = 0; i <= 0xF; i++)
+		{
+			tables.table0[0xC0 + i] = &Chip8::OP_00Cn;
+			tables.table0[0xD0 + i] = XOCHIP ? &Chip8::OP_00Dn : &Chip8::OP_NULL;
+		}
+
+		tables.tableF[0x30] = &Chip8::OP_Fx30;
+		tables.tableF[0x75] = &Chip8::OP_Fx75<QUIRKS>;
+		tables.tableF[0x85] = &Chip8::OP_Fx85<QUIRKS>;
+	}
+
+	if constexpr (XOCHIP)
+	{
+		tables.table5[0x0] = &Chip8::OP_5xy0<QUIRKS>;
+		tables.table5[0x2] = &Chip8::OP_5xy2<QUIRKS>;
+		tables.table5[0x3] = &Chip8::OP_5xy3<QUIRKS>;
+
+		tables.tableF[0x00] = &Chip8::OP_F000;
+		tables.tableF[0x01] = &Chip8::OP_Fn01;
+		tables.tableF[0x02] = &Chip8::OP_F002<QUIRKS>;
+		tables.tableF[0x3A] = &Chip8::OP_Fx3A;
+	}
+
+	tables.table8[0x0] = &Chip8::OP_8xy0;
+	tables.table8[0x1] = &Chip8::OP_8xy1;
+	tables.table8[0x2] = &Chip8::OP_8xy2;
+	tables.table8[0x3] = &Chip8::OP_8xy3;
+	tables.table8[0x4] = &Chip8::OP_8xy4;
+	tables.table8[0x5] = &Chip8::OP_8xy5;
+	tables.table8[0x6] = &Chip8::OP_8xy6<QUIRKS>;
+	tables.table8[0x7] = &Chip8::OP_8xy7;
+	tables.table8[0xE] = &Chip8::OP_8xyE<QUIRKS>;
+
+	tables.tableE[0x1] = &Chip8::OP_ExA1<QUIRKS>;
+	tables.tableE[0xE] = &Chip8::OP_Ex9E<QUIRKS>;
+
+	tables.tableF[0x07] = &Chip8::OP_Fx07;
+	tables.tableF[0x0A] = &Chip8::OP_Fx0A;
+	tables.tableF[0x15] = &Chip8::OP_Fx15;
+	tables.tableF[0x18] = &Chip8::OP_Fx18;
+	tables.tableF[0x1E] = &Chip8::OP_Fx1E;
+	tables.tableF[0x29] = &Chip8::OP_Fx29;
+	tables.tableF[0x33] = &Chip8::OP_Fx33<QUIRKS>;
+	tables.tableF[0x55] = &Chip8::OP_Fx55<QUIRKS>;
+	tables.tableF[0x65] = &Chip8::OP_Fx65<QUIRKS>;
+
+	return tables;
+}
+
+void Chip8::SetQuirkProfile(QuirkProfile profile)
+{
+	quirkProfile = profile;
+	dispatch = &Dispatch(profile);
+
+	// Nothing could leave high resolution or the other plane behind
+	if ((Quirks() & QUIRK_SCHIP) == 0 && hires)
+	{
+		hires = false;
+		std::memset(video, 0, sizeof(video));
+		MarkScreenDirty();
+	}
+
+	if ((Quirks() & QUIRK_XOCHIP) == 0)
+	{
+		planeMask = 1;
+		std::memset(video[1], 0, sizeof(video[1]));
+		MarkScreenDirty();
+	}
+
+	// Only XO-CHIP pays for the memory past 4 KB
+	extendedMemory.resize((Quirks() & QUIRK_XOCHIP) != 0 ? XO_MEMORY_SIZE - MEMORY_SIZE : 0);
+
+	FlushCodeCache();
+}
+
+char const* QuirkProfileName(QuirkProfile profile)
+{
+	switch (profile)
+	{
+	case QuirkProfile::Default: return "default";
+	case QuirkProfile::CosmacVip: return "vip";
+	case QuirkProfile::SuperChip: return "schip";
+	case QuirkProfile::XoChip: return "xochip";
+	}
+
+	return "unknown";
+}
+
+bool ParseQuirkProfile(char const* name, QuirkProfile& profile)
+{
+	for (unsigned int i = 0; i < QUIRK_PROFILE_COUNT; ++i)
+	{
+		if (std::strcmp(name, QuirkProfileName(static_cast<QuirkProfile>(i))) == 0)
+		{
+			profile = static_cast<QuirkProfile>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	Function to Load Contents of ROM FILE	// 
+//											//
+//////////////////////////////////////////////
+
+bool Chip8::LoadROM(char const* filename)
+{
+	// Mapped once and shared with every other machine running this file
+	std::shared_ptr<RomImage const> rom = OpenROM(filename, quirkProfile);
+
+	return rom && LoadROM(rom->Data(), rom->Size());
+}
+
+bool Chip8::LoadROM(uint8_t const* data, size_t size)
+{
+	if (size > MaxRomSizeOf(quirkProfile))
+	{
+		return false;
+	}
+
+	// One copy into memory, starting at 0x200. Only XO-CHIP ROMs can be
+	// long enough to carry on into the extended memory.
+	size_t low = size < MEMORY_SIZE - START_ADDRESS ? size : MEMORY_SIZE - START_ADDRESS;
+
+	std::memcpy(&memory[START_ADDRESS], data, low);
+
+	if (size > low)
+	{
+		std::memcpy(extendedMemory.data(), data + low, size - low);
+	}
+
+	// Anything decoded from the old image is stale now
+	FlushCodeCache();
+
+	return true;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	 Expand the Packed Framebuffer to RGBA	// 
+//											//
+//////////////////////////////////////////////
+
+void ExpandVideo(VideoPlanes const& video, bool hires, uint32_t* pixels, uint32_t const* palette)
+{
+	unsigned int scale = hires ? 1 : 2;
+
+	for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y)
+	{
+		unsigned int row = y / scale;
+
+		for (unsigned int x = 0; x < VIDEO_WIDTH; ++x)
+		{
+			unsigned int column = x / scale;
+			unsigned int shift = 63u - (column & 63u);
+			unsigned int strip = column >> 6u;
+
+			unsigned int color = ((video[0][strip][row] >> shift) & 1u)
+				| (((video[1][strip][row] >> shift) & 1u) << 1u);
+
+			pixels[y * VIDEO_WIDTH + x] = palette[color];
+		}
+	}
+}
+
+uint64_t Chip8::TakeDirtyRows()
+{
+	uint64_t rows = dirtyRows | unpresentedRows;
+	unrecordedRows |= dirtyRows;
+	dirtyRows = unpresentedRows = 0;
+
+	return rows;
+}
+
+uint64_t Chip8::TakeDirtyRowsToRecord()
+{
+	uint64_t rows = dirtyRows | unrecordedRows;
+	unpresentedRows |= dirtyRows;
+	dirtyRows = unrecordedRows = 0;
+
+	return rows;
+}
+
+void Chip8::MarkScreenDirty()
+{
+	dirtyRows |= hires ? ~0ull : (1ull << LORES_HEIGHT) - 1;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Decode an Opcode and its Operands		// 
+//											//
+//////////////////////////////////////////////
+
+Chip8::Instruction Chip8::Decode(uint16_t opcode) const
+{
+	Instruction ins;
+
+	ins.opcode = opcode;
+	ins.nnn = opcode & 0x0FFFu;
+	ins.x = (opcode & 0x0F00u) >> 8u;
+	ins.y = (opcode & 0x00F0u) >> 4u;
+	ins.kk = opcode & 0x00FFu;
+	ins.n = opcode & 0x000Fu;
+
+	// Resolve the second level tables here so executing is a single call
+	DispatchTables const& tables = *dispatch;
+
+	switch ((opcode & 0xF000u) >> 12u)
+	{
+	case 0x0: ins.handler = tables.table0[opcode & 0x00FFu]; break;
+	case 0x5: ins.handler = tables.table5[opcode & 0x000Fu]; break;
+	case 0x8: ins.handler = tables.table8[opcode & 0x000Fu]; break;
+	case 0xE: ins.handler = tables.tableE[opcode & 0x000Fu]; break;
+	case 0xF: ins.handler = tables.tableF[opcode & 0x00FFu]; break;
+	default: ins.handler = tables.table[(opcode & 0xF000u) >> 12u]; break;
+	}
+
+	return ins;
+}
+
+void Chip8::OP_NULL(Instruction const&)
+{
+	fault = Chip8Fault::InvalidOpcode;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Function to Clear the Display		// 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_00E0(Instruction const&)
+{
+	// Only the low resolution corner of plane 0 can ever be lit
+	if constexpr ((QUIRKS & QUIRK_SCHIP) == 0)
+	{
+		uint64_t* rows = video[0][0];
+
+		// Rows that were already blank don't change
+		for (unsigned int y = 0; y < LORES_HEIGHT; ++y)
+		{
+			dirtyRows |= (rows[y] != 0 ? 1ull : 0ull) << y;
+		}
+
+		memset(rows, 0, LORES_HEIGHT * sizeof(rows[0]));
+		return;
+	}
+
+	for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+	{
+		if (((planeMask >> plane) & 1u) == 0)
+		{
+			continue;
+		}
+
+		for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y)
+		{
+			dirtyRows |= ((video[plane][0][y] | video[plane][1][y]) != 0 ? 1ull : 0ull) << y;
+		}
+
+		memset(video[plane], 0, sizeof(video[plane]));
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Scroll the Display, SCHIP/XO-CHIP	//
+//											//
+//////////////////////////////////////////////
+
+// Whole rows move with one memmove per strip. Distances are in pixels of
+// the current resolution.
+void Chip8::OP_00Cn(Instruction const& ins)
+{
+	unsigned int height = hires ? VIDEO_HEIGHT : LORES_HEIGHT;
+	unsigned int strips = hires ? VIDEO_STRIPS : 1;
+	unsigned int distance = ins.n < height ? ins.n : height;
+
+	for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+	{
+		for (unsigned int strip = 0; strip < strips && ((planeMask >> plane) & 1u) != 0; ++strip)
+		{
+			uint64_t* rows = video[plane][strip];
+
+			std::memmove(&rows[distance], &rows[0], (height - distance) * sizeof(rows[0]));
+			std::memset(&rows[0], 0, distance * sizeof(rows[0]));
+		}
+	}
+
+	MarkScreenDirty();
+}
+
+void Chip8::OP_00Dn(Instruction const& ins)
+{
+	unsigned int height = hires ? VIDEO_HEIGHT : LORES_HEIGHT;
+	unsigned int strips = hires ? VIDEO_STRIPS : 1;
+	unsigned int distance = ins.n < height ? ins.n : height;
+
+	for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+	{
+		for (unsigned int strip = 0; strip < strips && ((planeMask >> plane) & 1u) != 0; ++strip)
+		{
+			uint64_t* rows = video[plane][strip];
+
+			std::memmove(&rows[0], &rows[distance], (height - distance) * sizeof(rows[0]));
+			std::memset(&rows[height - distance], 0, distance * sizeof(rows[0]));
+		}
+	}
+
+	MarkScreenDirty();
+}
+
+// Sideways, 4 pixels. Each row is one or two words, shifted two rows at a
+// time with the bits crossing between strips carried over.
+static void ScrollRows(uint64_t* left, uint64_t* right, unsigned int height, bool toRight)
+{
+	unsigned int y = 0;
+
+#if defined(CHIP8_SSE2)
+	for (; y + 2 <= height; y += 2)
+	{
+		__m128i l = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&left[y]));
+
+		if (right == nullptr)
+		{
+			l = toRight ? _mm_srli_epi64(l, 4) : _mm_slli_epi64(l, 4);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&left[y]), l);
+			continue;
+		}
+
+		__m128i r = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&right[y]));
+
+		if (toRight)
+		{
+			r = _mm_or_si128(_mm_srli_epi64(r, 4), _mm_slli_epi64(l, 60));
+			l = _mm_srli_epi64(l, 4);
+		}
+		else
+		{
+			l = _mm_or_si128(_mm_slli_epi64(l, 4), _mm_srli_epi64(r, 60));
+			r = _mm_slli_epi64(r, 4);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&left[y]), l);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&right[y]), r);
+	}
+#endif
+
+	for (; y < height; ++y)
+	{
+		if (right == nullptr)
+		{
+			left[y] = toRight ? left[y] >> 4u : left[y] << 4u;
+		}
+		else if (toRight)
+		{
+			right[y] = (right[y] >> 4u) | (left[y] << 60u);
+			left[y] >>= 4u;
+		}
+		else
+		{
+			left[y] = (left[y] << 4u) | (right[y] >> 60u);
+			right[y] <<= 4u;
+		}
+	}
+}
+
+void Chip8::OP_00FB(Instruction const&)
+{
+	for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+	{
+		if (((planeMask >> plane) & 1u) != 0)
+		{
+			ScrollRows(video[plane][0], hires ? video[plane][1] : nullptr, hires ? VIDEO_HEIGHT : LORES_HEIGHT, true);
+		}
+	}
+
+	MarkScreenDirty();
+}
+
+void Chip8::OP_00FC(Instruction const&)
+{
+	for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+	{
+		if (((planeMask >> plane) & 1u) != 0)
+		{
+			ScrollRows(video[plane][0], hires ? video[plane][1] : nullptr, hires ? VIDEO_HEIGHT : LORES_HEIGHT, false);
+		}
+	}
+
+	MarkScreenDirty();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Exit and Switch Resolution, SCHIP		//
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_00FD(Instruction const&)
+{
+	fault = Chip8Fault::Exit;
+}
+
+// Switching clears the screen, as XO-CHIP and later SCHIP builds do
+void Chip8::OP_00FE(Instruction const&)
+{
+	MarkScreenDirty();
+
+	hires = false;
+	std::memset(video, 0, sizeof(video));
+}
+
+void Chip8::OP_00FF(Instruction const&)
+{
+	hires = true;
+	std::memset(video, 0, sizeof(video));
+
+	MarkScreenDirty();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	 Function to Return from a subroutine	// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_00EE(Instruction const&)
+{
+	if (sp == 0)
+	{
+		fault = Chip8Fault::StackUnderflow;
+		return;
+	}
+
+	--sp;
+	pc = stack[sp];
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	    	Jump to location nnn		    // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_1nnn(Instruction const& ins)
+{
+	uint16_t address = ins.nnn;
+
+	pc = address;
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Call Subroutine at nnn		    // 
+//											//
+//////////////////////////////////////////////
+
+
+void Chip8::OP_2nnn(Instruction const& ins)
+{
+	uint16_t address = ins.nnn;
+
+	if (sp == 16)
+	{
+		fault = Chip8Fault::StackOverflow;
+		return;
+	}
+
+	stack[sp] = pc;
+	++sp;
+	pc = address;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	 Step Over the Next Instruction, which	//
+//	 is Four Bytes for XO-CHIP F000 nnnn	//
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::SkipNext()
+{
+	if constexpr ((QUIRKS & QUIRK_XOCHIP) != 0)
+	{
+		if (memory[pc & 0x0FFFu] == 0xF0 && memory[(pc + 1) & 0x0FFFu] == 0x00)
+		{
+			pc += 2;
+		}
+	}
+
+	pc += 2;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	    Skip next routine if Vx = kk	    // 
+//											//
+//////////////////////////////////////////////
+
+
+template <uint32_t QUIRKS>
+void Chip8::OP_3xkk(Instruction const& ins)
+{
+
+	uint8_t Vx = ins.x;
+	uint8_t byte = ins.kk;
+
+	if (registers[Vx] == byte)
+	{
+		SkipNext<QUIRKS>();
+	}
+}
+
+//////////////////////////////////////////////
+//											//
+//	  Skip next instruction if Vx != kk		// 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_4xkk(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t byte = ins.kk;
+
+	if (registers[Vx] != byte)
+	{
+		SkipNext<QUIRKS>();
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Skip next instruction if Vx = Vy		// 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_5xy0(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	if (registers[Vx] == registers[Vy])
+	{
+		SkipNext<QUIRKS>();
+	}
+}
+
+
+//////////////////////////////////////////////////////////////
+//															//
+//	Store or load Vx through Vy, either order, at I, XO-CHIP //
+//															//
+//////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_5xy2(Instruction const& ins)
+{
+	unsigned int count = (ins.x < ins.y ? ins.y - ins.x : ins.x - ins.y) + 1;
+	int step = ins.x < ins.y ? 1 : -1;
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		MemoryAt<QUIRKS>(index + i) = registers[ins.x + step * static_cast<int>(i)];
+	}
+
+	InvalidateCode(index, count);
+}
+
+template <uint32_t QUIRKS>
+void Chip8::OP_5xy3(Instruction const& ins)
+{
+	unsigned int count = (ins.x < ins.y ? ins.y - ins.x : ins.x - ins.y) + 1;
+	int step = ins.x < ins.y ? 1 : -1;
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		registers[ins.x + step * static_cast<int>(i)] = MemoryAt<QUIRKS>(index + i);
+	}
+}
+
+//////////////////////////////////////////////
+//											//
+//	        	Set Vx = kk				    // 
+//											//
+//////////////////////////////////////////////
+
+
+void Chip8::OP_6xkk(Instruction const& ins)
+{
+
+	uint8_t Vx = ins.x;
+	uint8_t byte = ins.kk;
+
+	registers[Vx] = byte;
+
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Set  Vx = Vx + kk    		    // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_7xkk(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t byte = ins.kk;
+
+	registers[Vx] += byte;
+}
+
+//////////////////////////////////////////////
+//											//
+//	    		Set Vx to Vy			    // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy0(Instruction const& ins)
+{
+
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	registers[Vx] = registers[Vy];
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Set Vx = Vx OR Vy			    // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy1(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	registers[Vx] |= registers[Vy];
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Set Vx = Vx AND Vy			    // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy2(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	registers[Vx] &= registers[Vy];
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Set Vx = Vx XOR Vy			    // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy3(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	registers[Vx] ^= registers[Vy];
+}
+
+//////////////////////////////////////////////
+//											//
+//	   Set Vx = Vx + Vy, set VF = carry		// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy4(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	uint16_t sum = registers[Vx] + registers[Vy];
+
+	if (sum > 255U)
+	{
+		registers[0xF] = 1;
+	}
+	else
+	{
+		registers[0xF] = 0;
+	}
+	registers[Vx] = sum & 0xFFu;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	Set Vx = Vx - Vy, set VF = NOT borrow	// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy5(Instruction const& ins)
+{
+
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	if (registers[Vx] > registers[Vy])
+	{
+		registers[0xF] = 1;
+	}
+	else
+	{
+		registers[0xF] = 0;
+	}
+
+	registers[Vx] -= registers[Vy];
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Set Vx = Vx SHR 1			    // 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_8xy6(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t source = (QUIRKS & QUIRK_SHIFT_VY) != 0 ? ins.y : ins.x;
+
+	// Save LSB in VF
+	registers[0xF] = (registers[source] & 0x1u);
+
+	registers[Vx] = registers[source] >> 1;
+}
+
+//////////////////////////////////////////////
+//											//
+//Set Vx = Vx = Vy - Vx, Set Vf = NOT borrow// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_8xy7(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	if (registers[Vy] > registers[Vx])
+	{
+		registers[0xF] = 1;
+	}
+	else
+	{
+		registers[0xF] = 0;
+	}
+
+	registers[Vx] = registers[Vy] - registers[Vx];
+}
+
+//////////////////////////////////////////////
+//											//
+//	    	Set Vx = Vx SHL 1			    // 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_8xyE(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t source = (QUIRKS & QUIRK_SHIFT_VY) != 0 ? ins.y : ins.x;
+
+	// Save MSB in VF
+	registers[0xF] = (registers[source] & 0x80u) >> 7u;
+
+	registers[Vx] = static_cast<uint8_t>(registers[source] << 1);
+}
+
+//////////////////////////////////////////////
+//											//
+//	  Skip next instruction if Vx != Vy		// 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_9xy0(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	if (registers[Vx] != registers[Vy])
+	{
+		SkipNext<QUIRKS>();
+	}
+}
+
+//////////////////////////////////////////////
+//											//
+//	    		Set i = nnn					// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Annn(Instruction const& ins)
+{
+	uint16_t address = ins.nnn;
+
+	index = address;
+}
+
+//////////////////////////////////////////////
+//											//
+//	      Jump to location nnn + V0		    // 
+//											//
+//////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Bnnn(Instruction const& ins)
+{
+	uint16_t address = ins.nnn;
+
+	// Bxnn adds Vx, the top nibble of the address doubling as x
+	pc = registers[(QUIRKS & QUIRK_JUMP_VX) != 0 ? ins.x : 0] + address;
+}
+
+//////////////////////////////////////////////
+//											//
+//	    Set Vx = Random byte AND kk			// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Cxkk(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t byte = ins.kk;
+
+	if (randBytesLeft == 0)
+	{
+		randBits = randomSource(randState);
+		randBytesLeft = 8;
+	}
+
+	registers[Vx] = static_cast<uint8_t>(randBits) & byte;
+	randBits >>= 8u;
+	--randBytesLeft;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//																						 //
+//	Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision	 //		     
+//																						 //
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Dxyn(Instruction const& ins)
+{
+	// What the original machine could draw stays on the fast path below
+	if constexpr ((QUIRKS & (QUIRK_SCHIP | QUIRK_XOCHIP)) != 0)
+	{
+		if (hires || ins.n == 0 || planeMask != 1)
+		{
+			DrawExtended<QUIRKS>(ins);
+			return;
+		}
+	}
+
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+	uint8_t height = ins.n;
+
+	// Wrap if going beyon screen boundaries
+	uint8_t xPos = registers[Vx] % LORES_WIDTH;
+	uint8_t yPos = registers[Vy] % LORES_HEIGHT;
+
+	if constexpr ((QUIRKS & QUIRK_WRAP_SPRITES) != 0)
+	{
+		// Rows that run off the bottom come back in at the top and columns
+		// off the right edge at the left, so rotate instead of shifting
+		uint64_t sprite[16];
+		uint64_t collision = 0;
+
+		for (unsigned int row = 0; row < height; ++row)
+		{
+			uint64_t bits = static_cast<uint64_t>(MemoryAt<QUIRKS>(index + row)) << 56u;
+			unsigned int y = (yPos + row) % LORES_HEIGHT;
+
+			sprite[row] = xPos == 0 ? bits : (bits >> xPos) | (bits << (64u - xPos));
+
+			collision |= video[0][0][y] & sprite[row];
+			video[0][0][y] ^= sprite[row];
+			dirtyRows |= (sprite[row] != 0 ? 1ull : 0ull) << y;
+		}
+
+		registers[0xF] = collision != 0 ? 1 : 0;
+
+		if constexpr (PROFILING_ENABLED)
+		{
+			if (profiler != nullptr)
+			{
+				profiler->Draw(sprite, height, collision != 0);
+			}
+		}
+
+		return;
+	}
+
+	// Sprites that run off the bottom are clipped
+	unsigned int rows = height < LORES_HEIGHT - yPos ? height : LORES_HEIGHT - yPos;
+
+	// Line each sprite byte up with its screen columns, anything pushed
+	// past the right edge falls off the end of the word
+	alignas(32) uint64_t sprite[16];
+
+	for (unsigned int row = 0; row < rows; ++row)
+	{
+		sprite[row] = (static_cast<uint64_t>(MemoryAt<QUIRKS>(index + row)) << 56u) >> xPos;
+
+		// XOR with an empty row changes nothing
+		dirtyRows |= (sprite[row] != 0 ? 1ull : 0ull) << (yPos + row);
+	}
+
+	uint64_t* screenRows = &video[0][0][yPos];
+	unsigned int row = 0;
+	uint64_t collision = 0;
+
+	// XOR the sprite in several rows at a time, any bit set in both is a collision
+#if defined(CHIP8_AVX2)
+	__m256i collisions256 = _mm256_setzero_si256();
+
+	for (; row + 4 <= rows; row += 4)
+	{
+		__m256i spriteRows = _mm256_load_si256(reinterpret_cast<__m256i const*>(&sprite[row]));
+		__m256i screen = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&screenRows[row]));
+
+		collisions256 = _mm256_or_si256(collisions256, _mm256_and_si256(screen, spriteRows));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&screenRows[row]), _mm256_xor_si256(screen, spriteRows));
+	}
+
+	collision |= _mm256_testz_si256(collisions256, collisions256) ? 0 : 1;
+#endif
+
+#if defined(CHIP8_SSE2)
+	__m128i collisions128 = _mm_setzero_si128();
+
+	for (; row + 2 <= rows; row += 2)
+	{
+		__m128i spriteRows = _mm_load_si128(reinterpret_cast<__m128i const*>(&sprite[row]));
+		__m128i screen = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&screenRows[row]));
+
+		collisions128 = _mm_or_si128(collisions128, _mm_and_si128(screen, spriteRows));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&screenRows[row]), _mm_xor_si128(screen, spriteRows));
+	}
+
+	collision |= _mm_movemask_epi8(_mm_cmpeq_epi8(collisions128, _mm_setzero_si128())) != 0xFFFF;
+#endif
+
+	for (; row < rows; ++row)
+	{
+		collision |= screenRows[row] & sprite[row];
+		screenRows[row] ^= sprite[row];
+	}
+
+	registers[0xF] = collision != 0 ? 1 : 0;
+
+	if constexpr (PROFILING_ENABLED)
+	{
+		if (profiler != nullptr)
+		{
+			profiler->Draw(sprite, rows, collision != 0);
+		}
+	}
+}
+
+// Place a row of up to 16 pixels, held from the most significant bit, at
+// column x of a 128 pixel row. Pixels past the right edge are dropped, or
+// come back in on the left when wrapping.
+static inline void PlaceRow(uint64_t bits, unsigned int x, bool wrap, uint64_t& left, uint64_t& right)
+{
+	if (x < 64)
+	{
+		left = bits >> x;
+		right = x == 0 ? 0 : bits << (64u - x);
+	}
+	else
+	{
+		left = wrap && x != 64 ? bits << (128u - x) : 0;
+		right = bits >> (x - 64u);
+	}
+}
+
+template <uint32_t QUIRKS>
+void Chip8::DrawExtended(Instruction const& ins)
+{
+	constexpr bool WRAP = (QUIRKS & QUIRK_WRAP_SPRITES) != 0;
+
+	unsigned int width = hires ? VIDEO_WIDTH : LORES_WIDTH;
+	unsigned int height = hires ? VIDEO_HEIGHT : LORES_HEIGHT;
+	unsigned int xPos = registers[ins.x] & (width - 1);
+	unsigned int yPos = registers[ins.y] & (height - 1);
+
+	// Dxy0 is 16x16, two bytes a row
+	bool large = ins.n == 0;
+	unsigned int rows = large ? 16 : ins.n;
+	unsigned int rowBytes = large ? 2 : 1;
+
+	// Each selected plane takes the next sprite's worth of bytes from I
+	uint16_t address = index;
+	uint64_t collision = 0;
+
+	uint64_t drawn[VIDEO_PLANES * 16 * VIDEO_STRIPS];
+	unsigned int drawnWords = 0;
+
+	for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+	{
+		if (((planeMask >> plane) & 1u) == 0)
+		{
+			continue;
+		}
+
+		uint64_t* left = video[plane][0];
+		uint64_t* right = video[plane][1];
+
+		for (unsigned int row = 0; row < rows; ++row)
+		{
+			unsigned int y = yPos + row;
+
+			if (y >= height)
+			{
+				if constexpr (!WRAP)
+				{
+					break;
+				}
+
+				y -= height;
+			}
+
+			uint16_t at = static_cast<uint16_t>(address + row * rowBytes);
+			uint64_t bits = static_cast<uint64_t>(MemoryAt<QUIRKS>(at)) << 56u;
+
+			if (large)
+			{
+				bits |= static_cast<uint64_t>(MemoryAt<QUIRKS>(at + 1)) << 48u;
+			}
+
+			uint64_t leftBits;
+			uint64_t rightBits = 0;
+
+			if (hires)
+			{
+				PlaceRow(bits, xPos, WRAP, leftBits, rightBits);
+			}
+			else
+			{
+				leftBits = (bits >> xPos) | (WRAP && xPos != 0 ? bits << (64u - xPos) : 0);
+			}
+
+			collision |= (left[y] & leftBits) | (right[y] & rightBits);
+			left[y] ^= leftBits;
+			right[y] ^= rightBits;
+
+			dirtyRows |= ((leftBits | rightBits) != 0 ? 1ull : 0ull) << y;
+
+			if constexpr (PROFILING_ENABLED)
+			{
+				drawn[drawnWords++] = leftBits;
+				drawn[drawnWords++] = rightBits;
+			}
+		}
+
+		address = static_cast<uint16_t>(address + rows * rowBytes);
+	}
+
+	registers[0xF] = collision != 0 ? 1 : 0;
+
+	if constexpr (PROFILING_ENABLED)
+	{
+		if (profiler != nullptr)
+		{
+			profiler->Draw(drawn, drawnWords, collision != 0);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////
+//														  //
+//	Skip next instruction if key with value Vx is pressed // 
+//														  //
+////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Ex9E(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+
+	// Only the low nibble names a key
+	uint8_t key = registers[Vx] & 0xFu;
+
+	if ((keypad >> key) & 1u)
+	{
+		SkipNext<QUIRKS>();
+	}
+}
+
+////////////////////////////////////////////////////////////////
+//															  //
+//	Skip next instruction if key with value Vx is not pressed // 
+//															  //
+////////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_ExA1(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t key = registers[Vx] & 0xFu;
+
+	if (((keypad >> key) & 1u) == 0)
+	{
+		SkipNext<QUIRKS>();
+	}
+
+}
+
+//////////////////////////////////////////////
+//											//
+//	     Set Vx = delay timer value			// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Fx07(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+
+	registers[Vx] = delayTimer;
+
+}
+
+////////////////////////////////////////////////////////////////
+//															  //
+//	Wait for a key press, store the value of the key in Vx    // 
+//															  //
+////////////////////////////////////////////////////////////////
+
+void Chip8::OP_Fx0A(Instruction const& ins)
+{
+	// Park rather than re-run this instruction until a key comes down
+	waitingForKey = true;
+	waitRegister = ins.x;
+
+	TryResume();
+}
+
+static inline uint8_t LowestKey(uint16_t keys)
+{
+#if defined(_MSC_VER)
+	unsigned long key;
+	_BitScanForward(&key, keys);
+	return static_cast<uint8_t>(key);
+#else
+	return static_cast<uint8_t>(__builtin_ctz(keys));
+#endif
+}
+
+bool Chip8::TryResume()
+{
+	if (!waitingForKey)
+	{
+		return true;
+	}
+
+	if (keypad == 0)
+	{
+		return false;
+	}
+
+	// The lowest key down wins
+	registers[waitRegister] = LowestKey(keypad);
+	waitingForKey = false;
+
+	return true;
+}
+
+//////////////////////////////////////////////
+//											//
+//	        Set delay timer = Vx			// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Fx15(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+
+	delayTimer = registers[Vx];
+}
+
+//////////////////////////////////////////////
+//											//
+//			Set sound timer = Vx			// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Fx18(Instruction const& ins)
+{
+
+	uint8_t Vx = ins.x;
+
+	soundTimer = registers[Vx];
+}
+
+//////////////////////////////////////////////
+//											//
+//			 Set I = I + Vx					// 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Fx1E(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+
+	index += registers[Vx];
+}
+
+//////////////////////////////////////////////
+//											//
+//  Set I = location of sprite for digit Vx // 
+//											//
+//////////////////////////////////////////////
+
+void Chip8::OP_Fx29(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t	digit = registers[Vx];
+
+	index = FONTSET_START_ADDRESS + (5 * digit);
+}
+
+//////////////////////////////////////////////////
+//												//
+//	Set I = large sprite for digit Vx, SCHIP	//
+//												//
+//////////////////////////////////////////////////
+
+void Chip8::OP_Fx30(Instruction const& ins)
+{
+	uint8_t digit = registers[ins.x] & 0xFu;
+
+	index = LARGE_FONTSET_START_ADDRESS + (10 * digit);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//																		 //
+//	Store BCD representation of Vx in memory locations I, I+1, and I+2   // 
+//																		 //
+///////////////////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Fx33(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+	uint8_t value = registers[Vx];
+
+	// Ones place
+	MemoryAt<QUIRKS>(index + 2) = value % 10;
+	value /= 10;
+
+	// Tens place
+	MemoryAt<QUIRKS>(index + 1) = value % 10;
+	value /= 10;
+
+	// Hundreds place
+	MemoryAt<QUIRKS>(index) = value % 10;
+
+	InvalidateCode(index, 3);
+}
+
+//////////////////////////////////////////////////////////////////////
+//																	//
+//	Store registers V0 through Vx in memory starting at location I  // 
+//																	//
+//////////////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Fx55(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+
+	for (uint8_t i = 0; i <= Vx; ++i)
+	{
+		MemoryAt<QUIRKS>(index + i) = registers[i];
+	}
+
+	InvalidateCode(index, Vx + 1);
+
+	if constexpr ((QUIRKS & QUIRK_INCREMENT_INDEX) != 0)
+	{
+		index += Vx + 1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+//																	 //  
+//	Read registers V0 through Vx from memory starting at location I  // 
+//																	 //
+///////////////////////////////////////////////////////////////////////
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Fx65(Instruction const& ins)
+{
+	uint8_t Vx = ins.x;
+
+	for (uint8_t i = 0; i <= Vx; ++i)
+	{
+		registers[i] = MemoryAt<QUIRKS>(index + i);
+	}
+
+	if constexpr ((QUIRKS & QUIRK_INCREMENT_INDEX) != 0)
+	{
+		index += Vx + 1;
+	}
+}
+
+//////////////////////////////////////////////////////
+//													//
+//	Save and restore V0 through Vx in the RPL flags	//
+//													//
+//////////////////////////////////////////////////////
+
+// SCHIP only has eight
+template <uint32_t QUIRKS>
+void Chip8::OP_Fx75(Instruction const& ins)
+{
+	unsigned int last = (QUIRKS & QUIRK_XOCHIP) != 0 ? ins.x : ins.x & 7u;
+
+	std::memcpy(flags, registers, last + 1);
+}
+
+template <uint32_t QUIRKS>
+void Chip8::OP_Fx85(Instruction const& ins)
+{
+	unsigned int last = (QUIRKS & QUIRK_XOCHIP) != 0 ? ins.x : ins.x & 7u;
+
+	std::memcpy(registers, flags, last + 1);
+}
+
+//////////////////////////////////////////////
+//											//
+//	 Long I, Planes and Audio, XO-CHIP		//
+//											//
+//////////////////////////////////////////////
+
+// The address is the next two bytes, which are stepped over
+void Chip8::OP_F000(Instruction const&)
+{
+	index = static_cast<uint16_t>((memory[pc & 0x0FFFu] << 8u) | memory[(pc + 1) & 0x0FFFu]);
+	pc += 2;
+}
+
+void Chip8::OP_Fn01(Instruction const& ins)
+{
+	planeMask = ins.x & 0x3u;
+}
+
+template <uint32_t QUIRKS>
+void Chip8::OP_F002(Instruction const&)
+{
+	for (unsigned int i = 0; i < sizeof(audioPattern); ++i)
+	{
+		audioPattern[i] = MemoryAt<QUIRKS>(index + i);
+	}
+}
+
+void Chip8::OP_Fx3A(Instruction const& ins)
+{
+	pitch = registers[ins.x];
+}
+
+
+
+//////////////////////////////
+//							//
+//	Fetch, Decode, Execute  //
+//							//
+//////////////////////////////
+
+void Chip8::Cycle()
+{
+	// Nothing to do once faulted or while parked in LD Vx, K
+	if (fault != Chip8Fault::None || !TryResume())
+	{
+		return;
+	}
+
+	// Fetch
+	pc &= 0x0FFFu;
+	uint16_t opcode = (memory[pc] << 8u) | memory[(pc + 1) & 0x0FFFu];
+
+	if constexpr (PROFILING_ENABLED)
+	{
+		if (profiler != nullptr)
+		{
+			profiler->Instruction(pc, opcode);
+		}
+	}
+
+	// Increment the PC before we execute anything
+	pc += 2;
+
+	// Decode and Execute
+	Instruction ins = Decode(opcode);
+	((*this).*(ins.handler))(ins);
+}
+
+uint32_t Chip8::Interpret(uint32_t maxCycles)
+{
+	if (fault != Chip8Fault::None || !TryResume())
+	{
+		return 0;
+	}
+
+	uint32_t executed = 0;
+
+	// Stop for the same reasons Run does
+	while (executed < maxCycles && !AtJumpToSelf())
+	{
+		Cycle();
+		++executed;
+
+		if (fault != Chip8Fault::None || waitingForKey)
+		{
+			break;
+		}
+	}
+
+	return executed;
+}
+
+bool Chip8::AtJumpToSelf() const
+{
+	uint16_t address = pc & 0x0FFFu;
+
+	return IsJumpToSelf(static_cast<uint16_t>((memory[address] << 8u) | memory[(address + 1) & 0x0FFFu]), address);
+}
+
+
+//////////////////////////////
+//							//
+//	   Tick at 60 Hz		//
+//							//
+//////////////////////////////
+
+void Chip8::TickTimers()
+{
+	// Decrement the delay timer if it's been set
+	if (delayTimer > 0)
+	{
+		--delayTimer;
+	}
+
+	// Decrement the sound timer if it's been set
+	if (soundTimer > 0)
+	{
+		--soundTimer;
+	}
+}
+
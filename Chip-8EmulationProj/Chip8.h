@@ -0,0 +1,557 @@
+#pragma once
+
+#include "Random.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if !defined(CHIP8_PROFILING)
+#define CHIP8_PROFILING 0
+#endif
+
+// Without CHIP8_PROFILING every profiler hook compiles away
+constexpr bool PROFILING_ENABLED = CHIP8_PROFILING != 0;
+
+class AudioSynth;
+class Profiler;
+class VideoWriter;
+
+// The framebuffer holds SCHIP's 128x64 high resolution mode. The original
+// 64x32 mode uses its top left corner.
+const unsigned int VIDEO_WIDTH = 128;
+const unsigned int VIDEO_HEIGHT = 64;
+const unsigned int LORES_WIDTH = 64;
+const unsigned int LORES_HEIGHT = 32;
+
+// 64 pixel wide strips of the screen, and XO-CHIP's two bitplanes
+const unsigned int VIDEO_STRIPS = VIDEO_WIDTH / 64;
+const unsigned int VIDEO_PLANES = 2;
+
+// Every profile has 4 KB, XO-CHIP addresses 64 KB through I. Jumps only
+// reach 12 bits, so code always runs from the first 4 KB.
+const unsigned int MEMORY_SIZE = 0x1000;
+const unsigned int CODE_SIZE = 0x1000;
+const unsigned int XO_MEMORY_SIZE = 0x10000;
+
+const unsigned int START_ADDRESS = 0x200;
+const unsigned int FONTSET_START_ADDRESS = 0x50;
+const unsigned int FONTSET_SIZE = 80;
+
+// SCHIP's 8x10 digits for Fx30, with XO-CHIP's A to F
+const unsigned int LARGE_FONTSET_START_ADDRESS = FONTSET_START_ADDRESS + FONTSET_SIZE;
+const unsigned int LARGE_FONTSET_SIZE = 160;
+
+// Why the CPU stopped doing useful work. The core never throws; callers
+// (the headless runner, the SDL front end) decide what a fault means.
+enum class Chip8Fault : uint8_t
+{
+	None,
+	InvalidOpcode,
+	StackOverflow,
+	StackUnderflow,
+	Exit			// SCHIP's 00FD, the program is done
+};
+
+// Why a run without a keyboard stopped. A program that spins on its own
+// address or waits in LD Vx, K never gets anywhere without input.
+enum class HaltReason : uint8_t
+{
+	CycleLimit,
+	JumpToSelf,
+	WaitForKey,
+	Exit,			// the program ended itself with 00FD
+	Fault
+};
+
+// Exit for a program that ended itself, Fault for any other fault
+inline HaltReason HaltReasonOf(Chip8Fault fault)
+{
+	return fault == Chip8Fault::Exit ? HaltReason::Exit : HaltReason::Fault;
+}
+
+// Behaviour that differs between CHIP-8 implementations
+enum Quirk : uint32_t
+{
+	QUIRK_SHIFT_VY = 1u << 0,			// 8xy6 and 8xyE shift Vy into Vx
+	QUIRK_INCREMENT_INDEX = 1u << 1,	// Fx55 and Fx65 leave I past the last register
+	QUIRK_JUMP_VX = 1u << 2,			// Bxnn jumps to xnn + Vx instead of nnn + V0
+	QUIRK_WRAP_SPRITES = 1u << 3,		// Dxyn wraps at the screen edges instead of clipping
+
+	// Instruction set extensions ride along in the same mask
+	QUIRK_SCHIP = 1u << 4,				// hires, scrolling, 16x16 sprites, large font, RPL flags
+	QUIRK_XOCHIP = 1u << 5				// 64 KB, bitplanes, audio pattern, 5xy2/5xy3, F000 nnnn, 00Dn
+};
+
+// The sets of quirks ROMs are written for. Each profile gets its own
+// dispatch tables of handlers specialised for its quirks at compile time,
+// so nothing checks a quirk while instructions run.
+enum class QuirkProfile : uint8_t
+{
+	Default,		// what this core has always done
+	CosmacVip,		// the original interpreter
+	SuperChip,		// SCHIP 1.1 on the HP 48
+	XoChip			// Octo's XO-CHIP
+};
+
+const unsigned int QUIRK_PROFILE_COUNT = 4;
+
+constexpr uint32_t QuirksOf(QuirkProfile profile)
+{
+	return profile == QuirkProfile::CosmacVip ? QUIRK_SHIFT_VY | QUIRK_INCREMENT_INDEX
+		: profile == QuirkProfile::SuperChip ? QUIRK_JUMP_VX | QUIRK_SCHIP
+		: profile == QuirkProfile::XoChip ? QUIRK_SHIFT_VY | QUIRK_INCREMENT_INDEX | QUIRK_WRAP_SPRITES | QUIRK_SCHIP | QUIRK_XOCHIP
+		: 0;
+}
+
+// Memory reached through I wraps at 4 KB except on XO-CHIP
+constexpr uint16_t AddressMaskOf(uint32_t quirks)
+{
+	return (quirks & QUIRK_XOCHIP) != 0 ? 0xFFFFu : 0x0FFFu;
+}
+
+// "default", "vip", "schip" and "xochip"
+char const* QuirkProfileName(QuirkProfile profile);
+bool ParseQuirkProfile(char const* name, QuirkProfile& profile);
+
+// Everything that makes up the machine and nothing else. Trivially
+// copyable, so saving or restoring it is a single memcpy.
+struct Chip8State
+{
+	uint8_t registers[16]{};
+	uint8_t memory[MEMORY_SIZE]{};
+	uint16_t index{};
+	uint16_t pc{};
+	uint16_t stack[16]{};
+	uint8_t sp{};
+	uint8_t delayTimer{};
+	uint8_t soundTimer{};
+	uint16_t keypad{};				// bit n is set while key n is down
+	Chip8Fault fault{};
+
+	// Set by LD Vx, K with no key down. The CPU stays parked, pc already
+	// past the instruction, until a key is down to put in waitRegister.
+	bool waitingForKey{};
+	uint8_t waitRegister{};
+
+	// Plane, then strip, then row, so each strip's rows sit next to each
+	// other for Dxyn and scrolling. The leftmost pixel of a strip is the
+	// most significant bit. Low resolution only uses strip 0, rows 0-31.
+	uint64_t video[VIDEO_PLANES][VIDEO_STRIPS][VIDEO_HEIGHT]{};
+
+	// SCHIP's 128x64 mode, and the XO-CHIP planes Dxyn, 00E0 and the
+	// scrolls work on (bit n is plane n)
+	bool hires{};
+	uint8_t planeMask{ 1 };
+
+	// SCHIP's RPL user flags, all 16 usable on XO-CHIP
+	uint8_t flags[16]{};
+
+	// XO-CHIP sound: 128 one-bit samples played while the sound timer
+	// runs, at 4000 * 2 ^ ((pitch - 64) / 48) samples a second
+	uint8_t audioPattern[16]{};
+	uint8_t pitch{ 64 };
+
+	// Cxkk takes the low byte of randBits and shifts it out, refilling
+	// from randState once all eight are used
+	uint64_t randState{};
+	uint64_t randBits{};
+	uint8_t randBytesLeft{};
+};
+
+static_assert(std::is_trivially_copyable<Chip8State>::value, "Chip8State must stay memcpy-able");
+
+typedef uint64_t VideoPlanes[VIDEO_PLANES][VIDEO_STRIPS][VIDEO_HEIGHT];
+
+// RGBA colors by plane bits: off, plane 0, plane 1, both
+const uint32_t DEFAULT_PALETTE[1u << VIDEO_PLANES] = { 0x00000000, 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF };
+
+// Expand a packed framebuffer to VIDEO_WIDTH x VIDEO_HEIGHT 32-bit pixels,
+// each low resolution pixel becoming a 2x2 block
+void ExpandVideo(VideoPlanes const& video, bool hires, uint32_t* pixels, uint32_t const* palette = DEFAULT_PALETTE);
+
+class Chip8 : public Chip8State
+{
+	friend class Jit;
+
+public:
+	struct Instruction;
+	typedef void (Chip8::* Chip8Func)(Instruction const&);
+
+	// An opcode with its operands already pulled apart and its handler
+	// already looked up, so executing it is a single call
+	struct Instruction
+	{
+		Chip8Func handler;
+		uint16_t opcode;
+		uint16_t nnn;
+		uint8_t x;
+		uint8_t y;
+		uint8_t kk;
+		uint8_t n;
+	};
+
+	// The default constructor seeds the RNG from the wall clock, pass a
+	// seed to get the same run every time
+	Chip8();
+	explicit Chip8(uint64_t seed);
+
+	// Restart the random sequence. The same seed and source always give
+	// the same Cxkk results.
+	void Seed(uint64_t seed);
+
+	// Swap the generator behind Cxkk, XorShift64Star by default. The
+	// source is not part of Chip8State; set the same one before replaying.
+	void SetRandomSource(RandomFunc source);
+
+	// Switch to the handlers for another set of quirks. Drops decoded
+	// blocks, they point at the old handlers.
+	void SetQuirkProfile(QuirkProfile profile);
+	QuirkProfile GetQuirkProfile() const { return quirkProfile; }
+	uint32_t Quirks() const { return QuirksOf(quirkProfile); }
+
+	// Returns false if the file could not be opened or doesn't fit
+	bool LoadROM(char const* filename);
+	bool LoadROM(uint8_t const* data, size_t size);
+
+	// Execute a single instruction, or nothing once faulted. Timers are not
+	// touched, they run off the 60 Hz clock in Scheduler.
+	void Cycle();
+
+	// Decrement the delay and sound timers, called once per 60 Hz frame
+	void TickTimers();
+
+	// Execute up to maxCycles instructions through the basic block cache.
+	// Returns early on a fault, a jump to self, or LD Vx, K with no key
+	// down, and returns 0 straight away if the machine has already
+	// faulted. Returns the number of instructions executed.
+	uint32_t Run(uint32_t maxCycles);
+
+	// A jump to itself never gets anywhere, so no engine executes one: a
+	// run stops with pc on it, wherever the run was split up
+	static bool IsJumpToSelf(uint16_t opcode, uint16_t address) { return opcode == (0x1000u | address); }
+	bool AtJumpToSelf() const;
+
+	// While parked in LD Vx, K, Cycle and Run execute nothing until a key
+	// is down. TryResume finishes the instruction if one is; it returns
+	// false if the CPU is still waiting.
+	bool WaitingForKey() const { return waitingForKey; }
+	bool TryResume();
+
+	// Same contract as Run, but fetches and decodes every instruction
+	// afresh. Slower, but nothing cached goes stale when a program keeps
+	// rewriting its own code.
+	uint32_t Interpret(uint32_t maxCycles);
+
+	// Must be called after writing code into memory from outside the core
+	void FlushCodeCache();
+
+	// Decode the blocks starting at addresses ahead of time, such as the
+	// ones RomAnalysis found, so Run doesn't stop to build them later
+	void WarmCodeCache(std::vector<uint16_t> const& addresses);
+
+	// Copy the whole machine out or back in. Under XO-CHIP, extended holds
+	// the ExtendedMemorySize() bytes past MEMORY_SIZE; a null one is not
+	// saved or restored. Restoring only drops cached blocks whose code
+	// actually differs in the snapshot.
+	void SaveState(Chip8State& state, uint8_t* extended = nullptr) const;
+	void LoadState(Chip8State const& state, uint8_t const* extended = nullptr);
+
+	// XO-CHIP's memory past MEMORY_SIZE, empty under every other profile.
+	// It lives outside Chip8State so the other profiles' states stay 4 KB.
+	uint8_t* ExtendedMemory() { return extendedMemory.data(); }
+	uint8_t const* ExtendedMemory() const { return extendedMemory.data(); }
+	size_t ExtendedMemorySize() const { return extendedMemory.size(); }
+
+	Instruction Decode(uint16_t opcode) const;
+
+	// Whether the current quirk profile has this instruction at all
+	bool IsValid(uint16_t opcode) const { return Decode(opcode).handler != &Chip8::OP_NULL; }
+
+	// Report to profiler from now on, null to stop. Ignored in builds
+	// without CHIP8_PROFILING.
+	void SetProfiler(Profiler* profiler) { this->profiler = PROFILING_ENABLED ? profiler : nullptr; }
+	Profiler* GetProfiler() const { return profiler; }
+
+	// Render sound at the end of every Scheduler frame, null for silence
+	void SetAudio(AudioSynth* audio) { this->audio = audio; }
+	AudioSynth* GetAudio() const { return audio; }
+
+	// Append every Scheduler frame to video as it ends, null to stop
+	void SetVideoWriter(VideoWriter* video) { this->videoWriter = video; }
+	VideoWriter* GetVideoWriter() const { return videoWriter; }
+
+	// Rows of video changed since the last call, bit n is row n in the
+	// current resolution. Nothing to present when it comes back 0.
+	// Switching resolution or loading a state marks every row.
+	uint64_t TakeDirtyRows();
+
+	// The same for the VideoWriter, kept apart so the presenter and the
+	// writer each see every row changed since they last looked
+	uint64_t TakeDirtyRowsToRecord();
+
+private:
+	// A straight-line run of decoded instructions ending at the first
+	// instruction that can change pc or write memory
+	struct Block
+	{
+		uint32_t first;
+		uint16_t start;
+		uint16_t count;
+		uint32_t native;
+	};
+
+	static constexpr uint16_t NO_BLOCK = 0xFFFF;
+	static constexpr uint32_t NO_NATIVE = 0xFFFFFFFF;
+	static constexpr unsigned int MAX_BLOCK_LENGTH = 64;
+	static constexpr unsigned int CODE_PAGE_SHIFT = 6;
+
+	static bool EndsBlock(Instruction const& ins);
+
+	// Run with or without profiler hooks
+	template <bool PROFILED>
+	uint32_t RunBlocks(uint32_t maxCycles);
+
+	uint16_t AddressMask() const { return AddressMaskOf(Quirks()); }
+
+	// The byte at an address I reaches, wrapped to the profile's memory
+	template <uint32_t QUIRKS>
+	uint8_t& MemoryAt(unsigned int address)
+	{
+		if constexpr ((QUIRKS & QUIRK_XOCHIP) != 0)
+		{
+			address &= 0xFFFFu;
+			return address < MEMORY_SIZE ? memory[address] : extendedMemory[address - MEMORY_SIZE];
+		}
+		else
+		{
+			return memory[address & 0x0FFFu];
+		}
+	}
+
+	// Skip the next instruction, all four bytes of an XO-CHIP F000 nnnn
+	template <uint32_t QUIRKS>
+	void SkipNext();
+
+	// Dxyn for high resolution, 16x16 sprites and planes other than 0
+	template <uint32_t QUIRKS>
+	void DrawExtended(Instruction const& ins);
+
+	// Mark every row of the current resolution dirty
+	void MarkScreenDirty();
+
+	Block const& BuildBlock(uint16_t address);
+	void InvalidateCode(uint16_t address, unsigned int length);
+
+	// Do nothing
+	void OP_NULL(Instruction const& ins);
+
+	// CLS
+	template <uint32_t QUIRKS>
+	void OP_00E0(Instruction const& ins);
+
+	// RET
+	void OP_00EE(Instruction const& ins);
+
+	// SCD n
+	void OP_00Cn(Instruction const& ins);
+
+	// SCU n
+	void OP_00Dn(Instruction const& ins);
+
+	// SCR
+	void OP_00FB(Instruction const& ins);
+
+	// SCL
+	void OP_00FC(Instruction const& ins);
+
+	// EXIT
+	void OP_00FD(Instruction const& ins);
+
+	// LOW
+	void OP_00FE(Instruction const& ins);
+
+	// HIGH
+	void OP_00FF(Instruction const& ins);
+
+	// JP address
+	void OP_1nnn(Instruction const& ins);
+
+	// CALL address
+	void OP_2nnn(Instruction const& ins);
+
+	// SE Vx, byte
+	template <uint32_t QUIRKS>
+	void OP_3xkk(Instruction const& ins);
+
+	// SNE Vx, byte
+	template <uint32_t QUIRKS>
+	void OP_4xkk(Instruction const& ins);
+
+	// SE Vx, Vy
+	template <uint32_t QUIRKS>
+	void OP_5xy0(Instruction const& ins);
+
+	// SAVE Vx - Vy
+	template <uint32_t QUIRKS>
+	void OP_5xy2(Instruction const& ins);
+
+	// LOAD Vx - Vy
+	template <uint32_t QUIRKS>
+	void OP_5xy3(Instruction const& ins);
+
+	// LD Vx, byte
+	void OP_6xkk(Instruction const& ins);
+
+	// ADD Vx, byte
+	void OP_7xkk(Instruction const& ins);
+
+	// LD Vx, Vy
+	void OP_8xy0(Instruction const& ins);
+
+	// OR Vx, Vy
+	void OP_8xy1(Instruction const& ins);
+
+	// AND Vx, Vy
+	void OP_8xy2(Instruction const& ins);
+
+	// XOR Vx, Vy
+	void OP_8xy3(Instruction const& ins);
+
+	// ADD Vx, Vy
+	void OP_8xy4(Instruction const& ins);
+
+	// SUB Vx, Vy
+	void OP_8xy5(Instruction const& ins);
+
+	// SHR Vx
+	template <uint32_t QUIRKS>
+	void OP_8xy6(Instruction const& ins);
+
+	// SUBN Vx, Vy
+	void OP_8xy7(Instruction const& ins);
+
+	// SHL Vx
+	template <uint32_t QUIRKS>
+	void OP_8xyE(Instruction const& ins);
+
+	// SNE Vx, Vy
+	template <uint32_t QUIRKS>
+	void OP_9xy0(Instruction const& ins);
+
+	// LD I, address
+	void OP_Annn(Instruction const& ins);
+
+	// JP V0, address
+	template <uint32_t QUIRKS>
+	void OP_Bnnn(Instruction const& ins);
+
+	// RND Vx, byte
+	void OP_Cxkk(Instruction const& ins);
+
+	// DRW Vx, Vy, height
+	template <uint32_t QUIRKS>
+	void OP_Dxyn(Instruction const& ins);
+
+	// SKP Vx
+	template <uint32_t QUIRKS>
+	void OP_Ex9E(Instruction const& ins);
+
+	// SKNP Vx
+	template <uint32_t QUIRKS>
+	void OP_ExA1(Instruction const& ins);
+
+	// LD I, long address
+	void OP_F000(Instruction const& ins);
+
+	// PLANE n
+	void OP_Fn01(Instruction const& ins);
+
+	// AUDIO
+	template <uint32_t QUIRKS>
+	void OP_F002(Instruction const& ins);
+
+	// LD Vx, DT
+	void OP_Fx07(Instruction const& ins);
+
+	// LD Vx, K
+	void OP_Fx0A(Instruction const& ins);
+
+	// LD DT, Vx
+	void OP_Fx15(Instruction const& ins);
+
+	// LD ST, Vx
+	void OP_Fx18(Instruction const& ins);
+
+	// ADD I, Vx
+	void OP_Fx1E(Instruction const& ins);
+
+	// LD F, Vx
+	void OP_Fx29(Instruction const& ins);
+
+	// LD HF, Vx
+	void OP_Fx30(Instruction const& ins);
+
+	// LD B, Vx
+	template <uint32_t QUIRKS>
+	void OP_Fx33(Instruction const& ins);
+
+	// PITCH Vx
+	void OP_Fx3A(Instruction const& ins);
+
+	// LD [I], Vx
+	template <uint32_t QUIRKS>
+	void OP_Fx55(Instruction const& ins);
+
+	// LD Vx, [I]
+	template <uint32_t QUIRKS>
+	void OP_Fx65(Instruction const& ins);
+
+	// LD R, Vx
+	template <uint32_t QUIRKS>
+	void OP_Fx75(Instruction const& ins);
+
+	// LD Vx, R
+	template <uint32_t QUIRKS>
+	void OP_Fx85(Instruction const& ins);
+
+	RandomFunc randomSource{ &XorShift64Star };
+
+	Profiler* profiler{};
+	AudioSynth* audio{};
+	VideoWriter* videoWriter{};
+
+	// Starts out all set so the first frame is always presented. Rows one
+	// taker has seen wait in the other's backlog until it takes them too.
+	uint64_t dirtyRows{ ~0ull };
+	uint64_t unpresentedRows{};
+	uint64_t unrecordedRows{};
+
+	// Handlers only depend on the quirk profile, so every Chip8 shares one
+	// set of tables per profile, built on first use
+	struct DispatchTables
+	{
+		Chip8Func table[0xF + 1];
+		Chip8Func table0[0xFF + 1];
+		Chip8Func table5[0xF + 1];
+		Chip8Func table8[0xF + 1];
+		Chip8Func tableE[0xF + 1];
+		Chip8Func tableF[0xFF + 1];
+	};
+
+	static DispatchTables const& Dispatch(QuirkProfile profile);
+
+	template <uint32_t QUIRKS>
+	static DispatchTables BuildDispatchTables();
+
+	QuirkProfile quirkProfile{ QuirkProfile::Default };
+	DispatchTables const* dispatch{ &Dispatch(QuirkProfile::Default) };
+
+	std::vector<uint8_t> extendedMemory;
+
+	// Basic block cache, filled lazily by Run
+	std::vector<Instruction> blockCode;
+	std::vector<Block> blocks;
+	std::vector<uint16_t> blockLookup;
+	uint64_t codePages{};
+};
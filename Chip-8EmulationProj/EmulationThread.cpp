@@ -0,0 +1,113 @@
+#include "EmulationThread.h"
+#include "Movie.h"
+#include "Rewind.h"
+#include "Scheduler.h"
+#include <chrono>
+#include <cstring>
+
+
+EmulationThread::EmulationThread(Chip8& chip8, Scheduler& scheduler, RewindBuffer* rewind, MovieWriter* movie)
+	: chip8(chip8), scheduler(scheduler), rewind(rewind), movie(movie)
+{
+}
+
+EmulationThread::~EmulationThread()
+{
+	Stop();
+}
+
+void EmulationThread::Start()
+{
+	if (thread.joinable())
+	{
+		return;
+	}
+
+	pacer.SetTargetPeriod(scheduler.FramePeriod());
+
+	running.store(true, std::memory_order_relaxed);
+	thread = std::thread(&EmulationThread::Main, this);
+}
+
+void EmulationThread::Stop()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	running.store(false, std::memory_order_relaxed);
+	thread.join();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Emulate and Publish Finished Frames	//
+//											//
+//////////////////////////////////////////////
+
+void EmulationThread::Main()
+{
+	bool canRewind = rewind != nullptr && (movie == nullptr || !movie->IsOpen());
+
+	// Whatever is on screen at start is the first frame
+	Publish();
+
+	while (running.load(std::memory_order_relaxed))
+	{
+		// Only the newest keypad counts
+		uint16_t keys;
+
+		while (input.Pop(keys))
+		{
+			chip8.keypad = keys;
+			++inputsApplied;
+		}
+
+		if (movie != nullptr)
+		{
+			movie->Record(scheduler.Frames(), chip8.keypad);
+		}
+
+		if (canRewind && rewindHeld.load(std::memory_order_relaxed))
+		{
+			rewind->Rewind(chip8);
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(16));
+		}
+		else if (scheduler.Update() > 0)
+		{
+			pacer.FrameDone(FramePacer::Clock::now());
+
+			if (rewind != nullptr)
+			{
+				rewind->Record(chip8);
+			}
+		}
+		else
+		{
+			// Keys that come in meanwhile wait for the frame anyway
+			pacer.WaitUntil(scheduler.NextFrameDue());
+			continue;
+		}
+
+		// Frames that drew nothing aren't worth waking the renderer for
+		if (chip8.TakeDirtyRows() != 0)
+		{
+			Publish();
+		}
+	}
+}
+
+void EmulationThread::Publish()
+{
+	VideoFrame& frame = frames.Back();
+
+	std::memcpy(frame.video, chip8.video, sizeof(frame.video));
+	frame.hires = chip8.hires;
+	frame.frame = scheduler.Frames();
+	frame.inputs = inputsApplied;
+
+	frames.Publish();
+}
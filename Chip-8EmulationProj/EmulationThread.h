@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Chip8.h"
+#include "FramePacer.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+class MovieWriter;
+class RewindBuffer;
+class Scheduler;
+
+// A finished frame as the renderer sees it
+struct VideoFrame
+{
+	VideoPlanes video;
+	bool hires;
+	uint64_t frame;
+
+	// Keypad updates from PushKeys the machine had seen when the frame
+	// was drawn
+	uint64_t inputs;
+};
+
+// Runs a Scheduler on a thread of its own so a slow present or a busy
+// event loop never holds up emulation. The UI thread sends key changes
+// through a queue and picks up the newest frame whenever it is ready to
+// draw; nothing here ever takes a lock.
+//
+// While running, the machine, scheduler, rewind buffer and movie belong
+// to the emulation thread and must not be touched from outside.
+class EmulationThread
+{
+public:
+	// rewind and movie are optional
+	EmulationThread(Chip8& chip8, Scheduler& scheduler, RewindBuffer* rewind = nullptr, MovieWriter* movie = nullptr);
+	~EmulationThread();
+
+	EmulationThread(EmulationThread const&) = delete;
+	EmulationThread& operator=(EmulationThread const&) = delete;
+
+	void Start();
+
+	// Returns once the thread has exited, the machine is the caller's again
+	void Stop();
+
+	// UI thread: queue the keypad as polled, bit n is key n. Returns false
+	// if the queue is full, try again later.
+	bool PushKeys(uint16_t keys) { return input.Push(keys); }
+
+	// UI thread: step back through the rewind buffer while held. Ignored
+	// while a movie is recording.
+	void SetRewindHeld(bool held) { rewindHeld.store(held, std::memory_order_relaxed); }
+
+	// UI thread: true if a frame newer than the last one returned was
+	// published, the newest is then in LatestFrame
+	bool AcquireFrame() { return frames.Acquire(); }
+	VideoFrame const& LatestFrame() const { return frames.Front(); }
+
+	// How evenly frames came out. Only read it while stopped.
+	FramePacer const& Pacer() const { return pacer; }
+
+private:
+	void Main();
+	void Publish();
+
+	Chip8& chip8;
+	Scheduler& scheduler;
+	RewindBuffer* rewind;
+	MovieWriter* movie;
+
+	SpscQueue<uint16_t, 64> input;
+	uint64_t inputsApplied{};
+
+	// Sleeps out the time until the scheduler's next frame is due
+	FramePacer pacer;
+	TripleBuffer<VideoFrame> frames;
+
+	std::atomic<bool> running{};
+	std::atomic<bool> rewindHeld{};
+	std::thread thread;
+};
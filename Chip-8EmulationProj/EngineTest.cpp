@@ -0,0 +1,350 @@
+#include "Analyzer.h"
+#include "Jit.h"
+#include "Scheduler.h"
+#include "TestSupport.h"
+
+
+//////////////////////////////////////////////
+//											//
+//	   Block Cache Against the Interpreter	//
+//											//
+//////////////////////////////////////////////
+
+TEST(Engines, BlockCacheMatchesInterpreter)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 150; ++seed)
+		{
+			Chip8 cached{ seed };
+			Chip8 interpreted{ seed };
+			LoadRandomRom(cached, seed, profile);
+			LoadRandomRom(interpreted, seed, profile);
+
+			// Both stop at the first fault, key wait or jump to itself
+			uint32_t cachedCycles = cached.Run(20000);
+			uint32_t interpretedCycles = interpreted.Interpret(20000);
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+			EXPECT_EQ(cachedCycles, interpretedCycles);
+			EXPECT_TRUE(SameState(cached, interpreted));
+		}
+	}
+}
+
+// A jump to itself at the end of a longer block stops the run with pc on
+// it, the same as one reached on its own
+TEST(Engines, JumpToSelfEndingABlock)
+{
+	const uint8_t rom[] = { 0x60, 0x01, 0x71, 0x01, 0x12, 0x04 };
+
+	Chip8 cached{ 1 };
+	Chip8 interpreted{ 1 };
+	cached.LoadROM(rom, sizeof(rom));
+	interpreted.LoadROM(rom, sizeof(rom));
+
+	EXPECT_EQ(cached.Run(100), 2u);
+	EXPECT_EQ(interpreted.Interpret(100), 2u);
+	EXPECT_EQ(cached.pc, 0x204);
+	EXPECT_TRUE(cached.AtJumpToSelf());
+	EXPECT_TRUE(SameState(cached, interpreted));
+
+	// Nothing more runs once there
+	EXPECT_EQ(cached.Run(100), 0u);
+	EXPECT_EQ(interpreted.Interpret(100), 0u);
+}
+
+
+//////////////////////////////////////////////
+//											//
+//			JIT Against the Interpreter		//
+//											//
+//////////////////////////////////////////////
+
+// On hosts without a backend this checks the block cache fallback instead
+TEST(Engines, JitMatchesInterpreter)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 150; ++seed)
+		{
+			Chip8 jitted{ seed };
+			Chip8 interpreted{ seed };
+			LoadRandomRom(jitted, seed, profile);
+			LoadRandomRom(interpreted, seed, profile);
+			jitted.keypad = interpreted.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			Jit jit(jitted);
+			Scheduler jitScheduler(jitted, &jit);
+			Scheduler interpretedScheduler(interpreted);
+			interpretedScheduler.SetUncached(true);
+
+			jitScheduler.Run(20000);
+			interpretedScheduler.Run(20000);
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+			EXPECT_EQ(jitScheduler.Cycles(), interpretedScheduler.Cycles());
+			EXPECT_EQ(jitScheduler.Frames(), interpretedScheduler.Frames());
+			EXPECT_TRUE(SameState(jitted, interpreted));
+		}
+	}
+}
+
+// Native code has to stop on a jump to self that ends a longer block too
+TEST(Engines, JitJumpToSelfEndingABlock)
+{
+	const uint8_t rom[] = { 0x60, 0x01, 0x71, 0x01, 0x12, 0x04 };
+
+	Chip8 jitted{ 1 };
+	Chip8 interpreted{ 1 };
+	jitted.LoadROM(rom, sizeof(rom));
+	interpreted.LoadROM(rom, sizeof(rom));
+
+	Jit jit(jitted);
+
+	// Twice, so the second run reuses the block compiled by the first
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		jitted.pc = interpreted.pc = START_ADDRESS;
+
+		EXPECT_EQ(jit.Run(100), 2u);
+		EXPECT_EQ(interpreted.Interpret(100), 2u);
+		EXPECT_TRUE(SameState(jitted, interpreted));
+	}
+}
+
+// How BatchRunner shares one Jit per worker across many machines
+TEST(Engines, DetachedJitServesMachinesInTurn)
+{
+	// Attach resets the blocks of the machine before, which has to outlive it
+	std::vector<Chip8> jitted;
+	std::vector<Chip8> interpreted;
+	jitted.reserve(20);
+	interpreted.reserve(20);
+
+	Jit jit;
+
+	for (uint32_t seed = 0; seed < 20; ++seed)
+	{
+		jitted.emplace_back(seed);
+		interpreted.emplace_back(seed);
+		LoadRandomRom(jitted.back(), seed, QuirkProfile::SuperChip);
+		LoadRandomRom(interpreted.back(), seed, QuirkProfile::SuperChip);
+
+		jit.Attach(jitted.back());
+
+		SCOPED_TRACE(::testing::Message() << "seed " << seed);
+		EXPECT_EQ(jit.Run(20000), interpreted.back().Interpret(20000));
+		EXPECT_TRUE(SameState(jitted.back(), interpreted.back()));
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//			  Self-Modifying Code			//
+//											//
+//////////////////////////////////////////////
+
+// The front ends send these through the interpreter, which must not change
+// what the program does
+TEST(Engines, SelfModifyingRomsMatchWhateverTheEngine)
+{
+	size_t checked = 0;
+
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 400; ++seed)
+		{
+			Chip8 interpreted{ seed };
+			LoadRandomRom(interpreted, seed, profile);
+
+			RomAnalysis analysis;
+			analysis.Analyze(interpreted);
+
+			if (!analysis.SelfModifying())
+			{
+				continue;
+			}
+
+			Chip8 cached{ seed };
+			Chip8 jitted{ seed };
+			LoadRandomRom(cached, seed, profile);
+			LoadRandomRom(jitted, seed, profile);
+			cached.WarmCodeCache(analysis.BlockStarts());
+			jitted.WarmCodeCache(analysis.BlockStarts());
+			interpreted.keypad = cached.keypad = jitted.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			Jit jit(jitted);
+			Scheduler interpretedScheduler(interpreted);
+			Scheduler cachedScheduler(cached);
+			Scheduler jitScheduler(jitted, &jit);
+			interpretedScheduler.SetUncached(true);
+
+			interpretedScheduler.Run(20000);
+			cachedScheduler.Run(20000);
+			jitScheduler.Run(20000);
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+			EXPECT_EQ(cachedScheduler.Cycles(), interpretedScheduler.Cycles());
+			EXPECT_EQ(jitScheduler.Cycles(), interpretedScheduler.Cycles());
+			EXPECT_EQ(cachedScheduler.Frames(), interpretedScheduler.Frames());
+			EXPECT_EQ(jitScheduler.Frames(), interpretedScheduler.Frames());
+			EXPECT_TRUE(SameState(cached, interpreted));
+			EXPECT_TRUE(SameState(jitted, interpreted));
+			++checked;
+		}
+	}
+
+	EXPECT_GT(checked, 0u);
+}
+
+// A store that rewrites an instruction later in the block being run
+TEST(Engines, StoreOverTheRunningBlock)
+{
+	const uint8_t rom[] =
+	{
+		0xA2, 0x08,		// I = 0x208
+		0x60, 0x71,		// V0 = 0x71
+		0x61, 0x05,		// V1 = 0x05
+		0xF1, 0x55,		// write 7105 over the next instruction
+		0x80, 0x0F,		// invalid until then
+		0x12, 0x0A		// jump to self
+	};
+
+	Chip8 interpreted{ 1 };
+	Chip8 cached{ 1 };
+	Chip8 jitted{ 1 };
+	interpreted.LoadROM(rom, sizeof(rom));
+	cached.LoadROM(rom, sizeof(rom));
+	jitted.LoadROM(rom, sizeof(rom));
+
+	RomAnalysis analysis;
+	analysis.Analyze(interpreted);
+	EXPECT_TRUE(analysis.SelfModifying());
+
+	Jit jit(jitted);
+
+	EXPECT_EQ(interpreted.Interpret(100), 5u);
+	EXPECT_EQ(cached.Run(100), 5u);
+	EXPECT_EQ(jit.Run(100), 5u);
+
+	EXPECT_EQ(interpreted.fault, Chip8Fault::None);
+	EXPECT_EQ(interpreted.registers[1], 0x0A);
+	EXPECT_EQ(interpreted.pc, 0x20A);
+	EXPECT_TRUE(SameState(cached, interpreted));
+	EXPECT_TRUE(SameState(jitted, interpreted));
+}
+
+//////////////////////////////////////////////
+//											//
+//		  Scheduler Stops and Chunks		//
+//											//
+//////////////////////////////////////////////
+
+// Frames and timers included, the engine behind the scheduler does not show
+TEST(Scheduler, CachedMatchesInterpreted)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 150; ++seed)
+		{
+			Chip8 cached{ seed };
+			Chip8 interpreted{ seed };
+			LoadRandomRom(cached, seed, profile);
+			LoadRandomRom(interpreted, seed, profile);
+			cached.keypad = interpreted.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			Scheduler cachedScheduler(cached);
+			Scheduler interpretedScheduler(interpreted);
+			interpretedScheduler.SetUncached(true);
+
+			cachedScheduler.Run(20000);
+			interpretedScheduler.Run(20000);
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+			EXPECT_EQ(cachedScheduler.Cycles(), interpretedScheduler.Cycles());
+			EXPECT_EQ(cachedScheduler.Frames(), interpretedScheduler.Frames());
+			EXPECT_TRUE(SameState(cached, interpreted));
+		}
+	}
+}
+
+// Where a run stops does not depend on how the caller splits it up
+TEST(Scheduler, ChunkedRunsMatchOneRun)
+{
+	std::mt19937 rng(5);
+
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 150; ++seed)
+		{
+			Chip8 whole{ seed };
+			Chip8 chunked{ seed };
+			LoadRandomRom(whole, seed, profile);
+			LoadRandomRom(chunked, seed, profile);
+			whole.keypad = chunked.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			Scheduler wholeScheduler(whole);
+			Scheduler chunkedScheduler(chunked);
+
+			uint32_t expected = wholeScheduler.Run(20000);
+			uint32_t executed = 0;
+
+			while (executed < 20000)
+			{
+				uint32_t chunk = 1 + rng() % 37;
+				chunk = chunk < 20000 - executed ? chunk : 20000 - executed;
+
+				uint32_t ran = chunkedScheduler.Run(chunk);
+				executed += ran;
+
+				if (ran < chunk)
+				{
+					break;
+				}
+			}
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+			EXPECT_EQ(executed, expected);
+			EXPECT_EQ(chunkedScheduler.Frames(), wholeScheduler.Frames());
+			EXPECT_TRUE(SameState(whole, chunked));
+		}
+	}
+}
+
+// A fault on the last instruction of a frame still ends the run there
+TEST(Scheduler, FaultOnAFramesLastInstruction)
+{
+	// Nine adds, then an opcode no profile has
+	uint8_t rom[20];
+
+	for (size_t at = 0; at < 18; at += 2)
+	{
+		rom[at] = 0x71;
+		rom[at + 1] = 0x01;
+	}
+
+	rom[18] = 0x80;
+	rom[19] = 0x0F;
+
+	Chip8 chip8{ 1 };
+	chip8.LoadROM(rom, sizeof(rom));
+
+	Scheduler scheduler(chip8);
+	scheduler.SetInstructionsPerFrame(10);
+
+	EXPECT_EQ(scheduler.Run(100), 10u);
+	EXPECT_EQ(chip8.fault, Chip8Fault::InvalidOpcode);
+	EXPECT_EQ(chip8.registers[1], 9);
+	EXPECT_EQ(scheduler.Frames(), 0u);
+
+	// Every entry point leaves a faulted machine alone
+	uint16_t pc = chip8.pc;
+	EXPECT_EQ(scheduler.Run(100), 0u);
+	EXPECT_EQ(chip8.Run(100), 0u);
+	EXPECT_EQ(chip8.Interpret(100), 0u);
+	chip8.Cycle();
+	EXPECT_EQ(chip8.pc, pc);
+	EXPECT_EQ(scheduler.Cycles(), 10u);
+}
@@ -0,0 +1,98 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+
+//////////////////////////////////////////////
+//											//
+//		  Percentiles of Recent Times		//
+//											//
+//////////////////////////////////////////////
+
+void TimingSamples::Add(std::chrono::steady_clock::duration time)
+{
+	auto micros = std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+
+	samples[count % CAPACITY] = static_cast<uint32_t>(micros < 0 ? 0 : micros > UINT32_MAX ? UINT32_MAX : micros);
+	++count;
+}
+
+double TimingSamples::Percentile(double p) const
+{
+	size_t kept = count < CAPACITY ? static_cast<size_t>(count) : CAPACITY;
+
+	if (kept == 0)
+	{
+		return 0.0;
+	}
+
+	// Only asked for now and then, so a copy to select from is fine
+	std::vector<uint32_t> sorted(samples, samples + kept);
+
+	double clamped = p < 0.0 ? 0.0 : p > 100.0 ? 100.0 : p;
+	size_t rank = static_cast<size_t>(clamped / 100.0 * (kept - 1) + 0.5);
+
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+	return sorted[rank] / 1000.0;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Sleep, Then Spin to the Deadline		//
+//											//
+//////////////////////////////////////////////
+
+constexpr std::chrono::microseconds FramePacer::MIN_SPIN_MARGIN;
+constexpr std::chrono::microseconds FramePacer::MAX_SPIN_MARGIN;
+
+void FramePacer::WaitUntil(Clock::time_point deadline)
+{
+	Clock::time_point now = Clock::now();
+
+	if (deadline - now > spinMargin)
+	{
+		Clock::time_point wake = deadline - spinMargin;
+		std::this_thread::sleep_until(wake);
+
+		// Stop sleeping earlier at once after a late wake, creep back
+		// towards the minimum while wakes are on time
+		Clock::duration late = Clock::now() - wake;
+
+		if (late > spinMargin)
+		{
+			spinMargin = late;
+		}
+		else
+		{
+			spinMargin -= (spinMargin - late) / 16;
+		}
+
+		spinMargin = std::min<Clock::duration>(std::max<Clock::duration>(spinMargin, MIN_SPIN_MARGIN), MAX_SPIN_MARGIN);
+	}
+
+	while (Clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::FrameDone(Clock::time_point time)
+{
+	if (started)
+	{
+		Clock::duration frameTime = time - lastFrame;
+
+		frameTimes.Add(frameTime);
+
+		if (targetPeriod > Clock::duration::zero())
+		{
+			jitter.Add(frameTime > targetPeriod ? frameTime - targetPeriod : targetPeriod - frameTime);
+		}
+	}
+
+	started = true;
+	lastFrame = time;
+}
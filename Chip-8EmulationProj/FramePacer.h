@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// The most recent durations of something, kept in microseconds so their
+// percentiles can be asked for at any time
+class TimingSamples
+{
+public:
+	static constexpr size_t CAPACITY = 4096;
+
+	void Add(std::chrono::steady_clock::duration time);
+	void Clear() { count = 0; }
+
+	// How many were added, even those the ring has since dropped
+	uint64_t Count() const { return count; }
+
+	// p from 0 to 100 over what is kept, in milliseconds. 0 when empty.
+	double Percentile(double p) const;
+
+private:
+	uint32_t samples[CAPACITY]{};
+	uint64_t count{};
+};
+
+// Waits for frame deadlines without pegging a core: sleeps until shortly
+// before the deadline, then yields in a loop for the rest. How early it
+// stops sleeping follows how late the OS has been waking it, so the spin
+// stays short on a precise timer and grows on a coarse one. Also keeps
+// the time between frames and how far that strays from the target.
+class FramePacer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Returns at deadline, or right away if it has passed
+	void WaitUntil(Clock::time_point deadline);
+
+	// What a frame should take, 0 when running unthrottled
+	void SetTargetPeriod(Clock::duration period) { targetPeriod = period; }
+
+	// A frame finished at time. The first one only starts the clock.
+	void FrameDone(Clock::time_point time);
+
+	// Time between frames and its distance from the target period
+	TimingSamples const& FrameTimes() const { return frameTimes; }
+	TimingSamples const& Jitter() const { return jitter; }
+
+	// How long before a deadline sleeping stops
+	Clock::duration SpinMargin() const { return spinMargin; }
+
+private:
+	static constexpr std::chrono::microseconds MIN_SPIN_MARGIN{ 250 };
+	static constexpr std::chrono::microseconds MAX_SPIN_MARGIN{ 4000 };
+
+	Clock::duration spinMargin{ std::chrono::milliseconds(1) };
+	Clock::duration targetPeriod{};
+
+	bool started{};
+	Clock::time_point lastFrame;
+
+	TimingSamples frameTimes;
+	TimingSamples jitter;
+};
@@ -0,0 +1,693 @@
+#include "Analyzer.h"
+#include "Audio.h"
+#include "BatchRunner.h"
+#include "Chip8.h"
+#include "Jit.h"
+#include "Movie.h"
+#include "Profiler.h"
+#include "Rom.h"
+#include "VideoFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+static void PrintUsage(char const* program)
+{
+	std::cerr << "Usage: " << program << " [options] <ROM>...\n"
+		<< "  --cycles N      Stop after N instructions (default 1000000)\n"
+		<< "  --ipf N         Instructions per 60 Hz timer tick (default 10)\n"
+		<< "  --jit           Translate hot blocks to native code (x86-64 only)\n"
+		<< "  --no-video      Do not dump the final framebuffer\n"
+		<< "  --instances N   Run N copies of every ROM (default 1)\n"
+		<< "  --threads N     Worker threads, 0 for one per core (default 0)\n"
+		<< "  --seed S        RNG seed of the first instance, the rest count up\n"
+		<< "  --lockstep      Run instances side by side in SIMD lanes\n"
+		<< "  --quirks NAME   Quirk profile: default, vip, schip or xochip\n"
+		<< "  --play FILE     Replay a movie recorded by the SDL front end\n"
+		<< "  --profile FILE  Write a JSON profile of a single instance run\n"
+		<< "  --folded FILE   Write the profile as collapsed stacks for flame graphs\n"
+		<< "  --wav FILE      Write the sound of a single instance run to a WAV file\n"
+		<< "  --video FILE    Write every frame of a single instance run to a video file\n"
+		<< "  --decode FILE   Read a video file back instead of running, no ROM needed\n"
+		<< "  --png PREFIX    With --decode, write frames as PREFIX-<frame>.png\n"
+		<< "  --every N       With --png, every Nth frame and the last (default 60)\n"
+		<< "  --analyze       Print the control flow graph and disassembly instead of running\n";
+}
+
+// In the current resolution, '+' and '@' are XO-CHIP's second plane and
+// both planes
+static void DumpVideo(VideoPlanes const& video, bool hires)
+{
+	static char const PIXELS[] = ".#+@";
+
+	unsigned int width = hires ? VIDEO_WIDTH : LORES_WIDTH;
+	unsigned int height = hires ? VIDEO_HEIGHT : LORES_HEIGHT;
+
+	std::printf("video:\n");
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		char line[VIDEO_WIDTH + 1];
+
+		for (unsigned int x = 0; x < width; ++x)
+		{
+			unsigned int shift = 63u - (x & 63u);
+			unsigned int strip = x >> 6u;
+
+			line[x] = PIXELS[((video[0][strip][y] >> shift) & 1u) | (((video[1][strip][y] >> shift) & 1u) << 1u)];
+		}
+		line[width] = '\0';
+
+		std::printf("%s\n", line);
+	}
+}
+
+static void DumpState(Chip8 const& chip8, bool dumpVideo)
+{
+	std::printf("pc: 0x%03X\n", chip8.pc);
+	std::printf("index: 0x%03X\n", chip8.index);
+	std::printf("sp: %u\n", chip8.sp);
+	std::printf("delay-timer: %u\n", chip8.delayTimer);
+	std::printf("sound-timer: %u\n", chip8.soundTimer);
+
+	std::printf("registers:");
+	for (unsigned int i = 0; i < 16; ++i)
+	{
+		std::printf(" %02X", chip8.registers[i]);
+	}
+	std::printf("\n");
+
+	std::printf("stack:");
+	for (unsigned int i = 0; i < chip8.sp && i < 16; ++i)
+	{
+		std::printf(" %03X", chip8.stack[i]);
+	}
+	std::printf("\n");
+
+	if (dumpVideo)
+	{
+		DumpVideo(chip8.video, chip8.hires);
+	}
+}
+
+// Where the profiler output goes, a null filename means not wanted
+struct ProfileOutput
+{
+	char const* jsonFilename{};
+	char const* foldedFilename{};
+
+	bool Wanted() const { return jsonFilename != nullptr || foldedFilename != nullptr; }
+};
+
+static bool WriteProfile(Profiler const& profiler, ProfileOutput const& output)
+{
+	bool written = true;
+
+	if (output.jsonFilename != nullptr)
+	{
+		std::FILE* file = std::fopen(output.jsonFilename, "w");
+		written &= file != nullptr && profiler.WriteJson(file);
+		written &= file != nullptr && std::fclose(file) == 0;
+	}
+
+	if (output.foldedFilename != nullptr)
+	{
+		std::FILE* file = std::fopen(output.foldedFilename, "w");
+		written &= file != nullptr && profiler.WriteFolded(file);
+		written &= file != nullptr && std::fclose(file) == 0;
+	}
+
+	if (!written)
+	{
+		std::cerr << "Could not write profile\n";
+	}
+
+	return written;
+}
+
+// Blocks in address order with their instructions, then what the code
+// was seen to draw, read and write
+static int PrintAnalysis(char const* romFilename, QuirkProfile quirkProfile)
+{
+	Chip8 chip8{ 0 };
+	chip8.SetQuirkProfile(quirkProfile);
+
+	if (!chip8.LoadROM(romFilename))
+	{
+		std::cerr << "Could not load ROM: " << romFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	RomAnalysis analysis;
+	analysis.Analyze(chip8);
+
+	std::vector<uint16_t> subroutines;
+
+	for (CallEdge const& call : analysis.Calls())
+	{
+		subroutines.push_back(call.target);
+	}
+
+	std::sort(subroutines.begin(), subroutines.end());
+	subroutines.erase(std::unique(subroutines.begin(), subroutines.end()), subroutines.end());
+
+	std::printf("rom: %s\n", romFilename);
+	std::printf("quirks: %s\n", QuirkProfileName(quirkProfile));
+	std::printf("blocks: %zu\n", analysis.Blocks().size());
+	std::printf("calls: %zu\n", analysis.Calls().size());
+	std::printf("subroutines: %zu\n", subroutines.size());
+	std::printf("indirect-jumps: %u\n", analysis.IndirectJumps());
+	std::printf("code-bytes: %zu\n", analysis.Count(ByteKind::Code));
+	std::printf("sprite-bytes: %zu\n", analysis.Count(ByteKind::Sprite));
+	std::printf("data-bytes: %zu\n", analysis.Count(ByteKind::Data));
+	std::printf("code-writes: %u\n", analysis.CodeWrites());
+	std::printf("untracked-writes: %u\n", analysis.UntrackedWrites());
+	std::printf("self-modifying: %s\n", analysis.SelfModifying() ? "yes" : "no");
+
+	for (BasicBlock const& block : analysis.Blocks())
+	{
+		bool subroutine = std::binary_search(subroutines.begin(), subroutines.end(), block.start);
+
+		std::printf("\nblock 0x%03X%s ->", block.start, subroutine ? " (subroutine)" : "");
+
+		for (uint16_t successor : block.successors)
+		{
+			if (successor != BasicBlock::NO_SUCCESSOR)
+			{
+				std::printf(" 0x%03X", successor);
+			}
+		}
+		std::printf("\n");
+
+		for (unsigned int address = block.start; address <= block.last;)
+		{
+			char text[32];
+			unsigned int length = Disassemble(chip8, static_cast<uint16_t>(address), text, sizeof(text));
+
+			std::printf("  0x%03X  %02X%02X  %s\n", address, chip8.memory[address], chip8.memory[(address + 1) & 0x0FFFu], text);
+			address += length;
+		}
+	}
+
+	// Runs of sprite and data bytes
+	for (unsigned int address = 0; address <= AddressMaskOf(chip8.Quirks());)
+	{
+		ByteKind kind = analysis.Kind(address);
+		unsigned int end = address + 1;
+
+		while (analysis.Kind(end) == kind && end <= AddressMaskOf(chip8.Quirks()))
+		{
+			++end;
+		}
+
+		if (kind == ByteKind::Sprite || kind == ByteKind::Data)
+		{
+			std::printf("\n%s 0x%03X-0x%03X\n", kind == ByteKind::Sprite ? "sprite" : "data", address, end - 1);
+		}
+
+		address = end;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// Steps through every frame of a recorded video, which also checks it
+// decodes, and prints the last one
+static int DecodeVideo(char const* videoFilename, char const* pngPrefix, uint64_t every, bool dumpVideo)
+{
+	VideoReader video;
+
+	if (!video.Open(videoFilename))
+	{
+		std::cerr << "Could not open video: " << videoFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	uint64_t frames = 0;
+	bool written = true;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// A record cut short leaves the frame half applied, so the last good
+	// one is kept aside for the end
+	VideoPlanes last{};
+	bool lastHires = false;
+
+	while (video.Next())
+	{
+		uint64_t frame = frames++;
+
+		if (pngPrefix != nullptr && frame % every == 0)
+		{
+			written &= WritePng((std::string(pngPrefix) + "-" + std::to_string(frame) + ".png").c_str(), video.Video(), video.Hires());
+		}
+
+		std::memcpy(last, video.Video(), sizeof(last));
+		lastHires = video.Hires();
+	}
+
+	if (pngPrefix != nullptr && frames > 0 && (frames - 1) % every != 0)
+	{
+		written &= WritePng((std::string(pngPrefix) + "-" + std::to_string(frames - 1) + ".png").c_str(), last, lastHires);
+	}
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	std::printf("video: %s\n", videoFilename);
+	std::printf("truncated: %s\n", video.Truncated() ? "yes" : "no");
+	std::printf("frames: %llu\n", static_cast<unsigned long long>(frames));
+	std::printf("changes: %llu\n", static_cast<unsigned long long>(video.Changes()));
+	std::printf("seconds: %.6f\n", seconds);
+	std::printf("fps: %.2f\n", seconds > 0.0 ? frames / seconds : 0.0);
+
+	if (dumpVideo && frames > 0)
+	{
+		DumpVideo(last, lastHires);
+	}
+
+	if (!written)
+	{
+		std::cerr << "Could not write PNG files: " << pngPrefix << "-*.png\n";
+		return EXIT_FAILURE;
+	}
+
+	return video.Truncated() ? 2 : EXIT_SUCCESS;
+}
+
+// Replays use the seed and pacing stored in the movie, only the ROM and
+// the JIT setting come from the command line
+static int PlayMovie(char const* movieFilename, char const* romFilename, bool useJit, bool dumpVideo, Profiler* profiler,
+	AudioSynth* audio, VideoWriter* videoWriter)
+{
+	MoviePlayer movie;
+
+	if (!movie.Open(movieFilename))
+	{
+		std::cerr << "Could not open movie: " << movieFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	std::shared_ptr<RomImage const> rom = OpenROM(romFilename, movie.GetQuirkProfile());
+
+	if (!rom)
+	{
+		std::cerr << "Could not load ROM: " << romFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	if (rom->Size() != movie.RomSize() || rom->Hash() != movie.RomHash())
+	{
+		std::cerr << "Movie was not recorded with this ROM: " << romFilename << "\n";
+		return EXIT_FAILURE;
+	}
+
+	Chip8 chip8{ movie.Seed() };
+
+	chip8.SetQuirkProfile(movie.GetQuirkProfile());
+	chip8.LoadROM(rom->Data(), rom->Size());
+
+	RomAnalysis analysis;
+	analysis.Analyze(chip8);
+	chip8.WarmCodeCache(analysis.BlockStarts());
+
+	std::unique_ptr<Jit> jit(useJit ? new Jit(chip8) : nullptr);
+	chip8.SetProfiler(profiler);
+	chip8.SetAudio(audio);
+	chip8.SetVideoWriter(videoWriter);
+
+	Scheduler scheduler(chip8, jit.get());
+	scheduler.SetInstructionsPerFrame(movie.InstructionsPerFrame());
+	scheduler.SetMode(Scheduler::Mode::Unthrottled);
+	scheduler.SetUncached(analysis.SelfModifying());
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	uint64_t frames = movie.Play(chip8, scheduler);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	std::printf("rom: %s\n", romFilename);
+	std::printf("movie: %s\n", movieFilename);
+	std::printf("seed: %llu\n", static_cast<unsigned long long>(movie.Seed()));
+	std::printf("truncated: %s\n", movie.Truncated() ? "yes" : "no");
+	std::printf("fault: %s\n", FaultName(chip8.fault));
+	std::printf("cycles: %llu\n", static_cast<unsigned long long>(scheduler.Cycles()));
+	std::printf("frames: %llu\n", static_cast<unsigned long long>(frames));
+	std::printf("seconds: %.6f\n", seconds);
+	std::printf("fps: %.2f\n", seconds > 0.0 ? frames / seconds : 0.0);
+
+	DumpState(chip8, dumpVideo);
+
+	// A program that ended itself with 00FD succeeded, as in the batch path
+	return chip8.fault != Chip8Fault::None && HaltReasonOf(chip8.fault) == HaltReason::Fault ? 2 : EXIT_SUCCESS;
+}
+
+
+int main(int argc, char** argv)
+{
+	uint64_t maxCycles = 1000000;
+	uint32_t instructionsPerFrame = 10;
+	bool dumpVideo = true;
+	bool useJit = false;
+	bool lockstep = false;
+	bool analyze = false;
+	uint32_t copies = 1;
+	unsigned int threads = 0;
+	uint64_t seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+	QuirkProfile quirkProfile = QuirkProfile::Default;
+	char const* movieFilename = nullptr;
+	char const* wavFilename = nullptr;
+	char const* videoFilename = nullptr;
+	char const* decodeFilename = nullptr;
+	char const* pngPrefix = nullptr;
+	uint64_t pngEvery = 60;
+	ProfileOutput profileOutput;
+	std::vector<char const*> romFilenames;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--cycles") == 0 && i + 1 < argc)
+		{
+			maxCycles = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--ipf") == 0 && i + 1 < argc)
+		{
+			instructionsPerFrame = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--jit") == 0)
+		{
+			useJit = true;
+		}
+		else if (std::strcmp(argv[i], "--lockstep") == 0)
+		{
+			lockstep = true;
+		}
+		else if (std::strcmp(argv[i], "--no-video") == 0)
+		{
+			dumpVideo = false;
+		}
+		else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+		{
+			copies = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			threads = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+		{
+			seed = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--quirks") == 0 && i + 1 < argc)
+		{
+			if (!ParseQuirkProfile(argv[++i], quirkProfile))
+			{
+				std::cerr << "Unknown quirk profile: " << argv[i] << "\n";
+				return EXIT_FAILURE;
+			}
+		}
+		else if (std::strcmp(argv[i], "--wav") == 0 && i + 1 < argc)
+		{
+			wavFilename = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--video") == 0 && i + 1 < argc)
+		{
+			videoFilename = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--decode") == 0 && i + 1 < argc)
+		{
+			decodeFilename = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--png") == 0 && i + 1 < argc)
+		{
+			pngPrefix = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--every") == 0 && i + 1 < argc)
+		{
+			pngEvery = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--analyze") == 0)
+		{
+			analyze = true;
+		}
+		else if (std::strcmp(argv[i], "--play") == 0 && i + 1 < argc)
+		{
+			movieFilename = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+		{
+			profileOutput.jsonFilename = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--folded") == 0 && i + 1 < argc)
+		{
+			profileOutput.foldedFilename = argv[++i];
+		}
+		else if (argv[i][0] != '-')
+		{
+			romFilenames.push_back(argv[i]);
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (decodeFilename != nullptr)
+	{
+		if (!romFilenames.empty() || pngEvery == 0)
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		return DecodeVideo(decodeFilename, pngPrefix, pngEvery, dumpVideo);
+	}
+
+	if (romFilenames.empty() || copies == 0)
+	{
+		PrintUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (analyze)
+	{
+		if (romFilenames.size() != 1)
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		return PrintAnalysis(romFilenames[0], quirkProfile);
+	}
+
+	if (useJit && !Jit::Supported())
+	{
+		std::cerr << "JIT is not supported on this host, interpreting\n";
+	}
+
+	// Profiles are of one machine run by the interpreter
+	std::unique_ptr<Profiler> profiler;
+
+	if (profileOutput.Wanted())
+	{
+		if (!PROFILING_ENABLED)
+		{
+			std::cerr << "Built without CHIP8_ENABLE_PROFILER\n";
+			return EXIT_FAILURE;
+		}
+
+		if (romFilenames.size() != 1 || copies != 1 || lockstep)
+		{
+			std::cerr << "Profiling needs a single instance without --lockstep\n";
+			return EXIT_FAILURE;
+		}
+
+		profiler.reset(new Profiler());
+	}
+
+	// Sound is likewise of one machine, written out as fast as it runs
+	WavWriter wav;
+	AudioSynth audio;
+
+	if (wavFilename != nullptr)
+	{
+		if (romFilenames.size() != 1 || copies != 1 || lockstep)
+		{
+			std::cerr << "Recording sound needs a single instance without --lockstep\n";
+			return EXIT_FAILURE;
+		}
+
+		if (!wav.Open(wavFilename, AudioSynth::SAMPLE_RATE))
+		{
+			std::cerr << "Could not create WAV file: " << wavFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		audio.SetWav(&wav);
+	}
+
+	// And so are frames
+	VideoWriter videoWriter;
+
+	if (videoFilename != nullptr)
+	{
+		if (romFilenames.size() != 1 || copies != 1 || lockstep)
+		{
+			std::cerr << "Recording video needs a single instance without --lockstep\n";
+			return EXIT_FAILURE;
+		}
+
+		if (!videoWriter.Open(videoFilename))
+		{
+			std::cerr << "Could not create video file: " << videoFilename << "\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (movieFilename != nullptr)
+	{
+		if (romFilenames.size() != 1)
+		{
+			PrintUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		int result = PlayMovie(movieFilename, romFilenames[0], useJit, dumpVideo, profiler.get(),
+			wav.IsOpen() ? &audio : nullptr, videoWriter.IsOpen() ? &videoWriter : nullptr);
+
+		if (profiler && !WriteProfile(*profiler, profileOutput))
+		{
+			return EXIT_FAILURE;
+		}
+
+		if (wav.IsOpen() && !wav.Finish())
+		{
+			std::cerr << "Could not write WAV file: " << wavFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		if (videoWriter.IsOpen() && !videoWriter.Finish())
+		{
+			std::cerr << "Could not write video file: " << videoFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		return result;
+	}
+
+	size_t total = romFilenames.size() * copies;
+
+	BatchRunner batch(total);
+	batch.SetMaxCycles(maxCycles);
+	batch.SetInstructionsPerFrame(instructionsPerFrame);
+	batch.SetUseJit(useJit);
+	batch.SetLockstep(lockstep);
+	batch.SetQuirkProfile(quirkProfile);
+
+	// Instance i runs ROM i / copies, all copies are loaded from one image
+	for (char const* romFilename : romFilenames)
+	{
+		std::shared_ptr<RomImage const> rom = OpenROM(romFilename, quirkProfile);
+
+		if (!rom)
+		{
+			std::cerr << "Could not load ROM: " << romFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		for (uint32_t copy = 0; copy < copies; ++copy)
+		{
+			batch.Add(rom->Data(), rom->Size(), seed + batch.Count());
+		}
+	}
+
+	ThreadPool pool(total > 1 ? threads : 1);
+
+	if (profiler)
+	{
+		batch.Instance(0).SetProfiler(profiler.get());
+	}
+
+	if (wav.IsOpen())
+	{
+		batch.Instance(0).SetAudio(&audio);
+	}
+
+	if (videoWriter.IsOpen())
+	{
+		batch.Instance(0).SetVideoWriter(&videoWriter);
+	}
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	batch.Run(pool);
+	auto endTime = std::chrono::high_resolution_clock::now();
+
+	double seconds = std::chrono::duration<double>(endTime - startTime).count();
+
+	if (total == 1)
+	{
+		uint64_t cycles = batch.Cycles(0);
+
+		std::printf("rom: %s\n", romFilenames[0]);
+		std::printf("halt: %s\n", HaltReasonName(batch.Halt(0)));
+		std::printf("fault: %s\n", FaultName(batch.Instance(0).fault));
+		std::printf("cycles: %llu\n", static_cast<unsigned long long>(cycles));
+		std::printf("frames: %llu\n", static_cast<unsigned long long>(batch.Frames(0)));
+		std::printf("seconds: %.6f\n", seconds);
+		std::printf("mips: %.2f\n", seconds > 0.0 ? cycles / seconds / 1e6 : 0.0);
+
+		DumpState(batch.Instance(0), dumpVideo);
+
+		if (profiler && !WriteProfile(*profiler, profileOutput))
+		{
+			return EXIT_FAILURE;
+		}
+
+		if (wav.IsOpen() && !wav.Finish())
+		{
+			std::cerr << "Could not write WAV file: " << wavFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		if (videoWriter.IsOpen() && !videoWriter.Finish())
+		{
+			std::cerr << "Could not write video file: " << videoFilename << "\n";
+			return EXIT_FAILURE;
+		}
+
+		return batch.Halt(0) == HaltReason::Fault ? 2 : EXIT_SUCCESS;
+	}
+
+	// One line per instance, then totals
+	uint64_t totalCycles = 0;
+	size_t faulted = 0;
+
+	for (size_t i = 0; i < total; ++i)
+	{
+		std::printf("instance %zu: rom=%s seed=%llu halt=%s fault=%s cycles=%llu frames=%llu\n",
+			i, romFilenames[i / copies], static_cast<unsigned long long>(batch.Seed(i)), HaltReasonName(batch.Halt(i)),
+			FaultName(batch.Instance(i).fault), static_cast<unsigned long long>(batch.Cycles(i)),
+			static_cast<unsigned long long>(batch.Frames(i)));
+
+		totalCycles += batch.Cycles(i);
+		faulted += batch.Halt(i) == HaltReason::Fault;
+	}
+
+	std::printf("instances: %zu\n", total);
+	std::printf("threads: %u\n", pool.Threads());
+	std::printf("faulted: %zu\n", faulted);
+	std::printf("cycles: %llu\n", static_cast<unsigned long long>(totalCycles));
+	std::printf("seconds: %.6f\n", seconds);
+	std::printf("mips: %.2f\n", seconds > 0.0 ? totalCycles / seconds / 1e6 : 0.0);
+
+	return faulted > 0 ? 2 : EXIT_SUCCESS;
+}
@@ -0,0 +1,498 @@
+#include "Jit.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHIP8_JIT_X64 1
+#endif
+
+#if defined(CHIP8_JIT_X64)
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+
+// x86-64 register numbers used in ModRM fields
+enum : uint8_t
+{
+	RAX = 0,
+	RCX = 1
+};
+
+
+// Called from generated code with the platform C calling convention
+static void CallHandler(Chip8* chip8, Chip8::Instruction const* ins)
+{
+	((*chip8).*(ins->handler))(*ins);
+}
+
+static int32_t OffsetOf(Chip8 const& chip8, void const* member)
+{
+	return static_cast<int32_t>(static_cast<uint8_t const*>(member) - reinterpret_cast<uint8_t const*>(&chip8));
+}
+
+
+Jit::Jit()
+{
+#if defined(CHIP8_JIT_X64)
+#if defined(_WIN32)
+	code = static_cast<uint8_t*>(VirtualAlloc(nullptr, CODE_CAPACITY, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+	void* mapping = mmap(nullptr, CODE_CAPACITY, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	code = mapping != MAP_FAILED ? static_cast<uint8_t*>(mapping) : nullptr;
+#endif
+#endif
+}
+
+Jit::Jit(Chip8& chip8)
+	: Jit()
+{
+	Attach(chip8);
+}
+
+Jit::~Jit()
+{
+	// Blocks must not keep pointing into a buffer that is going away
+	Reset();
+
+#if defined(CHIP8_JIT_X64)
+	if (code != nullptr)
+	{
+#if defined(_WIN32)
+		VirtualFree(code, 0, MEM_RELEASE);
+#else
+		munmap(code, CODE_CAPACITY);
+#endif
+	}
+#endif
+}
+
+bool Jit::Supported()
+{
+#if defined(CHIP8_JIT_X64)
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Jit::Attach(Chip8& machine)
+{
+	if (&machine == chip8)
+	{
+		return;
+	}
+
+	// The old machine's blocks can't keep pointing at code we are about to overwrite
+	Reset();
+	chip8 = &machine;
+
+	registersOffset = OffsetOf(machine, &machine.registers[0]);
+	indexOffset = OffsetOf(machine, &machine.index);
+	pcOffset = OffsetOf(machine, &machine.pc);
+}
+
+void Jit::Reset()
+{
+	codeSize = 0;
+	fallbacks.clear();
+
+	// Nothing was built yet if no machine was ever attached
+	if (chip8 == nullptr)
+	{
+		return;
+	}
+
+	for (Chip8::Block& block : chip8->blocks)
+	{
+		block.native = Chip8::NO_NATIVE;
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//			 Instruction Encoding			//
+//											//
+//////////////////////////////////////////////
+
+void Jit::Emit8(uint8_t value)
+{
+	code[codeSize++] = value;
+}
+
+void Jit::Emit16(uint16_t value)
+{
+	std::memcpy(code + codeSize, &value, sizeof(value));
+	codeSize += sizeof(value);
+}
+
+void Jit::Emit32(uint32_t value)
+{
+	std::memcpy(code + codeSize, &value, sizeof(value));
+	codeSize += sizeof(value);
+}
+
+void Jit::Emit64(uint64_t value)
+{
+	std::memcpy(code + codeSize, &value, sizeof(value));
+	codeSize += sizeof(value);
+}
+
+void Jit::EmitMem(uint8_t op, uint8_t reg, int32_t offset)
+{
+	// ModRM mod=10 (disp32), rm=011 (rbx)
+	Emit8(op);
+	Emit8(0x83u | (reg << 3u));
+	Emit32(static_cast<uint32_t>(offset));
+}
+
+void Jit::EmitMem(uint8_t prefix, uint8_t op, uint8_t reg, int32_t offset)
+{
+	Emit8(prefix);
+	EmitMem(op, reg, offset);
+}
+
+void Jit::EmitMem16(uint8_t op, uint8_t reg, int32_t offset)
+{
+	EmitMem(0x66, op, reg, offset);
+}
+
+void Jit::EmitStorePc(uint16_t address)
+{
+	// mov word [rbx + pc], address
+	EmitMem16(0xC7, 0, pcOffset);
+	Emit16(address);
+}
+
+void Jit::EmitCallHandler(Chip8::Instruction const& ins)
+{
+	fallbacks.push_back(ins);
+	Chip8::Instruction const* stable = &fallbacks.back();
+
+#if defined(_WIN32)
+	Emit8(0x48); Emit8(0x89); Emit8(0xD9);		// mov rcx, rbx
+	Emit8(0x48); Emit8(0xBA);					// mov rdx, imm64
+#else
+	Emit8(0x48); Emit8(0x89); Emit8(0xDF);		// mov rdi, rbx
+	Emit8(0x48); Emit8(0xBE);					// mov rsi, imm64
+#endif
+	Emit64(reinterpret_cast<uint64_t>(stable));
+
+	Emit8(0x48); Emit8(0xB8);					// mov rax, imm64
+	Emit64(reinterpret_cast<uint64_t>(&CallHandler));
+	Emit8(0xFF); Emit8(0xD0);					// call rax
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		 Native Translation of an Opcode	//
+//											//
+//////////////////////////////////////////////
+
+bool Jit::EmitNative(Chip8::Instruction const& ins, uint16_t address)
+{
+	int32_t vx = registersOffset + ins.x;
+	int32_t vy = registersOffset + ins.y;
+	int32_t vf = registersOffset + 0xF;
+	uint16_t next = static_cast<uint16_t>(address + 2);
+
+	switch ((ins.opcode & 0xF000u) >> 12u)
+	{
+	case 0x1:
+	{
+		EmitStorePc(ins.nnn);
+	}return true;
+
+	case 0x3:
+	case 0x4:
+	case 0x5:
+	case 0x9:
+	{
+		// XO-CHIP skips look at the next opcode, and 5xy2/5xy3 aren't skips
+		if (chip8->Quirks() & QUIRK_XOCHIP)
+		{
+			return false;
+		}
+
+		if ((ins.opcode & 0xF000u) == 0x3000u || (ins.opcode & 0xF000u) == 0x4000u)
+		{
+			EmitMem(0x80, 7, vx);				// cmp byte [Vx], kk
+			Emit8(ins.kk);
+		}
+		else
+		{
+			EmitMem(0x8A, RAX, vx);				// mov al, [Vx]
+			EmitMem(0x3A, RAX, vy);				// cmp al, [Vy]
+		}
+
+		// mov leaves the flags alone
+		Emit8(0xB8); Emit32(next);				// mov eax, next
+		Emit8(0xB9); Emit32(next + 2u);			// mov ecx, next + 2
+
+		bool skipIfEqual = (ins.opcode & 0xF000u) == 0x3000u || (ins.opcode & 0xF000u) == 0x5000u;
+
+		Emit8(0x0F); Emit8(skipIfEqual ? 0x44 : 0x45); Emit8(0xC1);	// cmove/cmovne eax, ecx
+		EmitMem16(0x89, RAX, pcOffset);			// mov [pc], ax
+	}return true;
+
+	case 0x6:
+	{
+		EmitMem(0xC6, 0, vx);					// mov byte [Vx], kk
+		Emit8(ins.kk);
+	}return true;
+
+	case 0x7:
+	{
+		EmitMem(0x80, 0, vx);					// add byte [Vx], kk
+		Emit8(ins.kk);
+	}return true;
+
+	case 0x8:
+	{
+		switch (ins.n)
+		{
+		case 0x0:
+		{
+			EmitMem(0x8A, RAX, vy);				// mov al, [Vy]
+			EmitMem(0x88, RAX, vx);				// mov [Vx], al
+		}return true;
+
+		case 0x1:
+		case 0x2:
+		case 0x3:
+		{
+			static const uint8_t ops[] = { 0x08, 0x20, 0x30 };	// or, and, xor
+
+			EmitMem(0x8A, RAX, vy);				// mov al, [Vy]
+			EmitMem(ops[ins.n - 1], RAX, vx);	// op [Vx], al
+		}return true;
+
+		case 0x4:
+		{
+			EmitMem(0x8A, RAX, vx);				// mov al, [Vx]
+			EmitMem(0x02, RAX, vy);				// add al, [Vy]
+			Emit8(0x0F); Emit8(0x92); Emit8(0xC1);	// setc cl
+			EmitMem(0x88, RCX, vf);				// mov [VF], cl
+			EmitMem(0x88, RAX, vx);				// mov [Vx], al
+		}return true;
+
+		case 0x5:
+		{
+			EmitMem(0x8A, RAX, vx);				// mov al, [Vx]
+			EmitMem(0x3A, RAX, vy);				// cmp al, [Vy]
+			Emit8(0x0F); Emit8(0x97); Emit8(0xC1);	// seta cl
+			EmitMem(0x88, RCX, vf);				// mov [VF], cl
+			EmitMem(0x8A, RAX, vy);				// mov al, [Vy]
+			EmitMem(0x28, RAX, vx);				// sub [Vx], al
+		}return true;
+
+		case 0x6:
+		{
+			// The shift quirks read Vy, left to the handler
+			if (chip8->Quirks() & QUIRK_SHIFT_VY)
+			{
+				return false;
+			}
+
+			EmitMem(0x8A, RAX, vx);				// mov al, [Vx]
+			Emit8(0x24); Emit8(0x01);			// and al, 1
+			EmitMem(0x88, RAX, vf);				// mov [VF], al
+			EmitMem(0xD0, 5, vx);				// shr byte [Vx], 1
+		}return true;
+
+		case 0x7:
+		{
+			EmitMem(0x8A, RAX, vy);				// mov al, [Vy]
+			EmitMem(0x3A, RAX, vx);				// cmp al, [Vx]
+			Emit8(0x0F); Emit8(0x97); Emit8(0xC1);	// seta cl
+			EmitMem(0x88, RCX, vf);				// mov [VF], cl
+			EmitMem(0x8A, RAX, vy);				// mov al, [Vy]
+			EmitMem(0x2A, RAX, vx);				// sub al, [Vx]
+			EmitMem(0x88, RAX, vx);				// mov [Vx], al
+		}return true;
+
+		case 0xE:
+		{
+			if (chip8->Quirks() & QUIRK_SHIFT_VY)
+			{
+				return false;
+			}
+
+			EmitMem(0x8A, RAX, vx);				// mov al, [Vx]
+			Emit8(0xC0); Emit8(0xE8); Emit8(7);	// shr al, 7
+			EmitMem(0x88, RAX, vf);				// mov [VF], al
+			EmitMem(0xD0, 4, vx);				// shl byte [Vx], 1
+		}return true;
+		}
+	}return false;
+
+	case 0xA:
+	{
+		EmitMem16(0xC7, 0, indexOffset);		// mov word [I], nnn
+		Emit16(ins.nnn);
+	}return true;
+
+	case 0xB:
+	{
+		if (chip8->Quirks() & QUIRK_JUMP_VX)
+		{
+			return false;
+		}
+
+		EmitMem(0x0F, 0xB6, RAX, registersOffset);	// movzx eax, byte [V0]
+		Emit8(0x05); Emit32(ins.nnn);			// add eax, nnn
+		EmitMem16(0x89, RAX, pcOffset);			// mov [pc], ax
+	}return true;
+
+	case 0xF:
+	{
+		if (ins.kk == 0x1E)
+		{
+			EmitMem(0x0F, 0xB6, RAX, vx);		// movzx eax, byte [Vx]
+			EmitMem16(0x01, RAX, indexOffset);	// add [I], ax
+			return true;
+		}
+
+		if (ins.kk == 0x29)
+		{
+			EmitMem(0x0F, 0xB6, RAX, vx);		// movzx eax, byte [Vx]
+			Emit8(0x8D); Emit8(0x84); Emit8(0x80);	// lea eax, [rax + rax * 4 + FONTSET_START_ADDRESS]
+			Emit32(FONTSET_START_ADDRESS);
+			EmitMem16(0x89, RAX, indexOffset);	// mov [I], ax
+			return true;
+		}
+	}return false;
+	}
+
+	return false;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Translate a Whole Block			//
+//											//
+//////////////////////////////////////////////
+
+void Jit::Compile(Chip8::Block& block)
+{
+	if (CODE_CAPACITY - codeSize < (block.count + 2u) * MAX_INSTRUCTION_BYTES)
+	{
+		Reset();
+	}
+
+	block.native = static_cast<uint32_t>(codeSize);
+
+	// Prologue: rbx is callee-saved and holds the machine for the block
+	Emit8(0x53);								// push rbx
+#if defined(_WIN32)
+	Emit8(0x48); Emit8(0x89); Emit8(0xCB);		// mov rbx, rcx
+	Emit8(0x48); Emit8(0x83); Emit8(0xEC); Emit8(0x20);	// sub rsp, 32 (shadow space)
+#else
+	Emit8(0x48); Emit8(0x89); Emit8(0xFB);		// mov rbx, rdi
+#endif
+
+	Chip8::Instruction const* ins = &chip8->blockCode[block.first];
+	uint16_t address = block.start;
+	bool pcWritten = false;
+
+	for (unsigned int i = 0; i < block.count; ++i, address += 2)
+	{
+		if (EmitNative(ins[i], address))
+		{
+			pcWritten = Chip8::EndsBlock(ins[i]);
+			continue;
+		}
+
+		// The interpreter sees pc exactly as it would have
+		EmitStorePc(static_cast<uint16_t>(address + 2));
+		EmitCallHandler(ins[i]);
+
+		pcWritten = true;
+	}
+
+	if (!pcWritten)
+	{
+		EmitStorePc(address);
+	}
+
+	// Epilogue
+#if defined(_WIN32)
+	Emit8(0x48); Emit8(0x83); Emit8(0xC4); Emit8(0x20);	// add rsp, 32
+#endif
+	Emit8(0x5B);								// pop rbx
+	Emit8(0xC3);								// ret
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Execute Through Translated Blocks	//
+//											//
+//////////////////////////////////////////////
+
+uint32_t Jit::Run(uint32_t maxCycles)
+{
+	// Translated blocks can't count instructions, let the profiler see them
+	if (code == nullptr || (PROFILING_ENABLED && chip8->profiler != nullptr))
+	{
+		return chip8->Run(maxCycles);
+	}
+
+	if (chip8->fault != Chip8Fault::None || !chip8->TryResume())
+	{
+		return 0;
+	}
+
+	uint32_t executed = 0;
+
+	while (executed < maxCycles)
+	{
+		chip8->pc &= 0x0FFFu;
+
+		uint16_t blockIndex = chip8->blockLookup.empty() ? Chip8::NO_BLOCK : chip8->blockLookup[chip8->pc];
+
+		if (blockIndex == Chip8::NO_BLOCK)
+		{
+			chip8->BuildBlock(chip8->pc);
+			blockIndex = chip8->blockLookup[chip8->pc];
+		}
+
+		Chip8::Block& block = chip8->blocks[blockIndex];
+
+		if (Chip8::IsJumpToSelf(chip8->blockCode[block.first].opcode, block.start))
+		{
+			break;
+		}
+
+		// Blocks run to completion, let the interpreter finish a partial one
+		if (block.count > maxCycles - executed)
+		{
+			executed += chip8->Run(maxCycles - executed);
+			break;
+		}
+
+		if (block.native == Chip8::NO_NATIVE)
+		{
+			Compile(block);
+		}
+
+		// Copy out what we need, the last instruction may invalidate the block
+		uint32_t blockCount = block.count;
+
+		reinterpret_cast<BlockFunc>(code + block.native)(chip8);
+
+		executed += blockCount;
+
+		if (chip8->fault != Chip8Fault::None || chip8->waitingForKey)
+		{
+			break;
+		}
+	}
+
+	return executed;
+}
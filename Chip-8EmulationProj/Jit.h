@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Translates the basic blocks cached by Chip8::Run into x86-64 code.
+// The machine pointer is pinned to rbx for the whole block, so V0-VF, I
+// and pc are plain [rbx + offset] operands. ALU ops, loads, skips and
+// jumps are emitted natively; everything else (draws, LD Vx, K, the
+// stack, timer access, memory transfers) calls back into the interpreter's
+// handler. Self-modifying code is handled by the block cache: when Fx33
+// or Fx55 write a page that holds code, the overlapping blocks are
+// dropped and their translations become unreachable.
+class Jit
+{
+public:
+	// A Jit made without a machine translates nothing until Attach
+	Jit();
+	explicit Jit(Chip8& chip8);
+	~Jit();
+
+	Jit(Jit const&) = delete;
+	Jit& operator=(Jit const&) = delete;
+
+	// False on hosts without an x86-64 backend, Run then just interprets
+	static bool Supported();
+
+	// Switch to translating for another machine, dropping the code built
+	// for the current one. Lets one Jit serve many machines in turn.
+	void Attach(Chip8& machine);
+
+	// Same contract as Chip8::Run
+	uint32_t Run(uint32_t maxCycles);
+
+private:
+	typedef void (*BlockFunc)(Chip8*);
+
+	static const size_t CODE_CAPACITY = 1u << 20;
+
+	// Worst case bytes for one instruction plus the prologue/epilogue
+	static const size_t MAX_INSTRUCTION_BYTES = 64;
+
+	void Compile(Chip8::Block& block);
+	void Reset();
+
+	void Emit8(uint8_t value);
+	void Emit16(uint16_t value);
+	void Emit32(uint32_t value);
+	void Emit64(uint64_t value);
+
+	// op [rbx + offset] with optional prefix and ModRM reg field
+	void EmitMem(uint8_t op, uint8_t reg, int32_t offset);
+	void EmitMem(uint8_t prefix, uint8_t op, uint8_t reg, int32_t offset);
+	void EmitMem16(uint8_t op, uint8_t reg, int32_t offset);
+
+	void EmitStorePc(uint16_t address);
+	void EmitCallHandler(Chip8::Instruction const& ins);
+
+	// Native translations, false means call the interpreter instead
+	bool EmitNative(Chip8::Instruction const& ins, uint16_t address);
+
+	Chip8* chip8{};
+
+	uint8_t* code{};
+	size_t codeSize{};
+
+	// Handlers called from native code need a stable address for their
+	// Instruction, the block cache's vector can move
+	std::deque<Chip8::Instruction> fallbacks;
+
+	int32_t registersOffset{};
+	int32_t indexOffset{};
+	int32_t pcOffset{};
+};
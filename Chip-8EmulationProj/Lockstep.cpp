@@ -0,0 +1,819 @@
+#include "Lockstep.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#define CHIP8_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHIP8_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+//////////////////////////////////////////////
+//											//
+//	   One Byte per Lane Vector Helpers		//
+//											//
+//////////////////////////////////////////////
+
+// Lanes hold one byte per machine. Masks are 0xFF in the lanes that take
+// part and 0x00 elsewhere.
+#if defined(CHIP8_AVX2)
+typedef __m256i Lanes;
+
+static inline Lanes Load(uint8_t const* p) { return _mm256_load_si256(reinterpret_cast<__m256i const*>(p)); }
+static inline void Store(uint8_t* p, Lanes v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+static inline Lanes Splat(uint8_t value) { return _mm256_set1_epi8(static_cast<char>(value)); }
+static inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_epi8(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return _mm256_sub_epi8(a, b); }
+static inline Lanes And(Lanes a, Lanes b) { return _mm256_and_si256(a, b); }
+static inline Lanes Or(Lanes a, Lanes b) { return _mm256_or_si256(a, b); }
+static inline Lanes Xor(Lanes a, Lanes b) { return _mm256_xor_si256(a, b); }
+static inline Lanes Equal(Lanes a, Lanes b) { return _mm256_cmpeq_epi8(a, b); }
+static inline Lanes AddSaturate(Lanes a, Lanes b) { return _mm256_adds_epu8(a, b); }
+static inline Lanes SubSaturate(Lanes a, Lanes b) { return _mm256_subs_epu8(a, b); }
+static inline Lanes ShiftRight1(Lanes a) { return _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)); }
+static inline Lanes Select(Lanes mask, Lanes a, Lanes b) { return _mm256_blendv_epi8(b, a, mask); }
+static inline uint32_t MaskBits(Lanes mask) { return static_cast<uint32_t>(_mm256_movemask_epi8(mask)); }
+#elif defined(CHIP8_SSE2)
+typedef __m128i Lanes;
+
+static inline Lanes Load(uint8_t const* p) { return _mm_load_si128(reinterpret_cast<__m128i const*>(p)); }
+static inline void Store(uint8_t* p, Lanes v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+static inline Lanes Splat(uint8_t value) { return _mm_set1_epi8(static_cast<char>(value)); }
+static inline Lanes Add(Lanes a, Lanes b) { return _mm_add_epi8(a, b); }
+static inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_epi8(a, b); }
+static inline Lanes And(Lanes a, Lanes b) { return _mm_and_si128(a, b); }
+static inline Lanes Or(Lanes a, Lanes b) { return _mm_or_si128(a, b); }
+static inline Lanes Xor(Lanes a, Lanes b) { return _mm_xor_si128(a, b); }
+static inline Lanes Equal(Lanes a, Lanes b) { return _mm_cmpeq_epi8(a, b); }
+static inline Lanes AddSaturate(Lanes a, Lanes b) { return _mm_adds_epu8(a, b); }
+static inline Lanes SubSaturate(Lanes a, Lanes b) { return _mm_subs_epu8(a, b); }
+static inline Lanes ShiftRight1(Lanes a) { return _mm_and_si128(_mm_srli_epi16(a, 1), _mm_set1_epi8(0x7F)); }
+static inline Lanes Select(Lanes mask, Lanes a, Lanes b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+static inline uint32_t MaskBits(Lanes mask) { return static_cast<uint32_t>(_mm_movemask_epi8(mask)); }
+#else
+struct Lanes
+{
+	uint8_t v[Lockstep::LANES];
+};
+
+template <typename Op>
+static inline Lanes Map(Lanes a, Lanes b, Op op)
+{
+	Lanes r;
+
+	for (unsigned int i = 0; i < Lockstep::LANES; ++i)
+	{
+		r.v[i] = static_cast<uint8_t>(op(a.v[i], b.v[i]));
+	}
+
+	return r;
+}
+
+static inline Lanes Load(uint8_t const* p) { Lanes r; for (unsigned int i = 0; i < Lockstep::LANES; ++i) r.v[i] = p[i]; return r; }
+static inline void Store(uint8_t* p, Lanes v) { for (unsigned int i = 0; i < Lockstep::LANES; ++i) p[i] = v.v[i]; }
+static inline Lanes Splat(uint8_t value) { Lanes r; for (unsigned int i = 0; i < Lockstep::LANES; ++i) r.v[i] = value; return r; }
+static inline Lanes Add(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x + y; }); }
+static inline Lanes Sub(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x - y; }); }
+static inline Lanes And(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x & y; }); }
+static inline Lanes Or(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x | y; }); }
+static inline Lanes Xor(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x ^ y; }); }
+static inline Lanes Equal(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x == y ? 0xFFu : 0u; }); }
+static inline Lanes AddSaturate(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x + y > 0xFFu ? 0xFFu : x + y; }); }
+static inline Lanes SubSaturate(Lanes a, Lanes b) { return Map(a, b, [](unsigned int x, unsigned int y) { return x > y ? x - y : 0u; }); }
+static inline Lanes ShiftRight1(Lanes a) { return Map(a, a, [](unsigned int x, unsigned int) { return x >> 1u; }); }
+static inline Lanes Select(Lanes mask, Lanes a, Lanes b) { return Or(And(mask, a), Map(mask, b, [](unsigned int m, unsigned int y) { return ~m & y; })); }
+static inline uint32_t MaskBits(Lanes mask) { uint32_t r = 0; for (unsigned int i = 0; i < Lockstep::LANES; ++i) r |= (mask.v[i] >> 7u) << i; return r; }
+#endif
+
+// 1 in the lanes where mask is set, 0 elsewhere
+static inline Lanes Flag(Lanes mask)
+{
+	return And(mask, Splat(1));
+}
+
+static inline Lanes Not(Lanes a)
+{
+	return Xor(a, Splat(0xFF));
+}
+
+// Write value into the lanes set in mask, leave the rest alone
+static inline void StoreMasked(uint8_t* row, Lanes value, Lanes mask)
+{
+	Store(row, Select(mask, value, Load(row)));
+}
+
+static inline unsigned int LowestLane(uint32_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long lane;
+	_BitScanForward(&lane, bits);
+	return static_cast<unsigned int>(lane);
+#else
+	return static_cast<unsigned int>(__builtin_ctz(bits));
+#endif
+}
+
+static inline uint16_t Fetch(Chip8 const& chip8, uint16_t address)
+{
+	return static_cast<uint16_t>((chip8.memory[address] << 8u) | chip8.memory[(address + 1) & 0x0FFFu]);
+}
+
+
+Lockstep::Lockstep(Chip8* machines, unsigned int count)
+	: machines(machines), count(count < LANES ? count : LANES)
+{
+}
+
+void Lockstep::SetInstructionsPerFrame(uint32_t count)
+{
+	instructionsPerFrame = count > 0 ? count : 1;
+
+	// Like Scheduler, a frame already past the new length ends now
+	for (unsigned int lane = 0; lane < this->count; ++lane)
+	{
+		if (frameCycles[lane] >= instructionsPerFrame)
+		{
+			machines[lane].TickTimers();
+			frameCycles[lane] = 0;
+			++frames[lane];
+		}
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Move Lane State In and Out of SoA		//
+//											//
+//////////////////////////////////////////////
+
+void Lockstep::Gather()
+{
+	for (unsigned int lane = 0; lane < count; ++lane)
+	{
+		Chip8 const& chip8 = machines[lane];
+
+		for (unsigned int r = 0; r < 16; ++r)
+		{
+			registers[r][lane] = chip8.registers[r];
+		}
+
+		pc[lane] = chip8.pc;
+		index[lane] = chip8.index;
+		delayTimer[lane] = chip8.delayTimer;
+		soundTimer[lane] = chip8.soundTimer;
+	}
+}
+
+void Lockstep::Scatter()
+{
+	for (unsigned int lane = 0; lane < count; ++lane)
+	{
+		Chip8& chip8 = machines[lane];
+
+		for (unsigned int r = 0; r < 16; ++r)
+		{
+			chip8.registers[r] = registers[r][lane];
+		}
+
+		chip8.pc = pc[lane];
+		chip8.index = index[lane];
+		chip8.delayTimer = delayTimer[lane];
+		chip8.soundTimer = soundTimer[lane];
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		 Run Lanes Grouped by Their PC		//
+//											//
+//////////////////////////////////////////////
+
+void Lockstep::Run(uint64_t maxCycles)
+{
+	// Lanes parked in LD Vx, K pick up their key before being gathered
+	for (unsigned int lane = 0; lane < count; ++lane)
+	{
+		machines[lane].TryResume();
+	}
+
+	Gather();
+
+	// Lanes loaded with the same program can skip comparing opcodes until
+	// one of them writes to memory
+	sharedCode = true;
+
+	for (unsigned int lane = 1; lane < count && sharedCode; ++lane)
+	{
+		sharedCode = std::memcmp(machines[lane].memory, machines[0].memory, CODE_SIZE) == 0;
+	}
+
+	uint32_t runnable = 0;
+
+	for (unsigned int lane = 0; lane < count; ++lane)
+	{
+		halts[lane] = machines[lane].fault != Chip8Fault::None ? HaltReasonOf(machines[lane].fault) : HaltReason::CycleLimit;
+
+		if (halts[lane] == HaltReason::CycleLimit)
+		{
+			runnable |= 1u << lane;
+		}
+	}
+
+	// Per lane counts stay 32-bit inside a chunk
+	const uint64_t CHUNK_CYCLES = 1u << 30;
+
+	while (maxCycles > 0 && runnable != 0)
+	{
+		// Parked with no key down, including lanes that got there on the
+		// last instruction of the previous chunk
+		for (uint32_t bits = runnable; bits != 0; bits &= bits - 1)
+		{
+			unsigned int lane = LowestLane(bits);
+
+			if (machines[lane].WaitingForKey())
+			{
+				halts[lane] = HaltReason::WaitForKey;
+				runnable &= ~(1u << lane);
+			}
+		}
+
+		uint32_t chunk = static_cast<uint32_t>(maxCycles < CHUNK_CYCLES ? maxCycles : CHUNK_CYCLES);
+
+		runnable = RunChunk(runnable, chunk);
+		maxCycles -= chunk;
+	}
+
+	Scatter();
+}
+
+uint32_t Lockstep::RunChunk(uint32_t lanes, uint32_t cycleLimit)
+{
+	live = lanes;
+	limit = cycleLimit;
+	exhausted = 0;
+	together = false;
+	pending = 0;
+
+	for (unsigned int lane = 0; lane < LANES; ++lane)
+	{
+		liveMask[lane] = (live >> lane) & 1u ? 0xFF : 0x00;
+		ran[lane] = 0;
+	}
+
+	TryJoin();
+
+	while (live != 0)
+	{
+		if (together)
+		{
+			StepTogether();
+		}
+		else
+		{
+			StepApart();
+		}
+	}
+
+	return exhausted;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Cycle Counts, Frames and Halting		//
+//											//
+//////////////////////////////////////////////
+
+// steps never carries a lane past the end of its frame or its limit
+uint32_t Lockstep::Count(uint32_t lanes, uint32_t steps)
+{
+	uint32_t stopped = 0;
+
+	for (uint32_t bits = lanes; bits != 0; bits &= bits - 1)
+	{
+		unsigned int lane = LowestLane(bits);
+
+		cycles[lane] += steps;
+		ran[lane] += steps;
+		frameCycles[lane] += steps;
+
+		if (frameCycles[lane] == instructionsPerFrame)
+		{
+			frameCycles[lane] = 0;
+			++frames[lane];
+
+			if (delayTimer[lane] > 0)
+			{
+				--delayTimer[lane];
+			}
+
+			if (soundTimer[lane] > 0)
+			{
+				--soundTimer[lane];
+			}
+		}
+
+		if (ran[lane] == limit)
+		{
+			stopped |= 1u << lane;
+		}
+	}
+
+	return stopped;
+}
+
+uint32_t Lockstep::UntilEvent() const
+{
+	uint32_t steps = 0xFFFFFFFFu;
+
+	for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+	{
+		unsigned int lane = LowestLane(bits);
+		uint32_t frameLeft = instructionsPerFrame - frameCycles[lane];
+		uint32_t limitLeft = limit - ran[lane];
+
+		steps = frameLeft < steps ? frameLeft : steps;
+		steps = limitLeft < steps ? limitLeft : steps;
+	}
+
+	return steps;
+}
+
+void Lockstep::Stop(uint32_t lanes)
+{
+	for (uint32_t bits = lanes; bits != 0; bits &= bits - 1)
+	{
+		unsigned int lane = LowestLane(bits);
+
+		if (together)
+		{
+			pc[lane] = sharedPc;
+		}
+
+		liveMask[lane] = 0;
+	}
+
+	live &= ~lanes;
+}
+
+void Lockstep::Settle()
+{
+	if (pending > 0)
+	{
+		uint32_t stopped = Count(live, pending);
+		pending = 0;
+
+		exhausted |= stopped;
+		Stop(stopped);
+	}
+
+	if (together)
+	{
+		untilEvent = UntilEvent();
+	}
+}
+
+void Lockstep::Split()
+{
+	for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+	{
+		pc[LowestLane(bits)] = sharedPc;
+	}
+
+	together = false;
+	Settle();
+}
+
+void Lockstep::TryJoin()
+{
+	if (live == 0)
+	{
+		return;
+	}
+
+	uint16_t first = pc[LowestLane(live)];
+
+	for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+	{
+		if (pc[LowestLane(bits)] != first)
+		{
+			return;
+		}
+	}
+
+	together = true;
+	sharedPc = first;
+	pending = 0;
+	untilEvent = UntilEvent();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Step With Every Live Lane at One PC	//
+//											//
+//////////////////////////////////////////////
+
+// The common case once lanes line up: pc and the cycle counts are kept
+// once for the whole group, so an instruction costs the same whether
+// one lane runs it or all of them do
+void Lockstep::StepTogether()
+{
+	uint16_t address = sharedPc & 0x0FFFu;
+	uint16_t opcode = Fetch(machines[LowestLane(live)], address);
+
+	if (!sharedCode)
+	{
+		for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+		{
+			if (Fetch(machines[LowestLane(bits)], address) != opcode)
+			{
+				Split();
+				return;
+			}
+		}
+	}
+
+	// Like the other engines, stop with pc on a jump to self rather than
+	// run it. Lanes out of cycles stop on the limit, the rest on the jump.
+	if (Chip8::IsJumpToSelf(opcode, address))
+	{
+		Settle();
+
+		for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+		{
+			halts[LowestLane(bits)] = HaltReason::JumpToSelf;
+		}
+
+		Stop(live);
+		return;
+	}
+
+	Chip8::Instruction ins = machines[0].Decode(opcode);
+	alignas(32) uint8_t skip[LANES];
+
+	if (ExecuteStraight(ins, liveMask))
+	{
+		sharedPc = address + 2;
+	}
+	else if ((opcode & 0xF000u) == 0x1000u)
+	{
+		sharedPc = ins.nnn;
+	}
+	else if (SkipCondition(ins, skip))
+	{
+		uint32_t taken = MaskBits(Load(skip)) & live;
+
+		if (taken != 0 && taken != live)
+		{
+			for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+			{
+				unsigned int lane = LowestLane(bits);
+				pc[lane] = static_cast<uint16_t>(address + ((taken >> lane) & 1u ? 4 : 2));
+			}
+
+			together = false;
+			++pending;
+			Settle();
+			return;
+		}
+
+		sharedPc = address + (taken != 0 ? 4 : 2);
+	}
+	else
+	{
+		// Everything else runs lane by lane
+		Split();
+		StepApart();
+		return;
+	}
+
+	++pending;
+
+	if (pending == untilEvent)
+	{
+		Settle();
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Step the Lanes at the Lowest PC		//
+//											//
+//////////////////////////////////////////////
+
+void Lockstep::StepApart()
+{
+	// Lowest pc goes first, so lanes that fell behind on a branch catch
+	// up with the ones ahead and run together again
+	uint16_t address = 0xFFFF;
+
+	for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+	{
+		uint16_t at = pc[LowestLane(bits)] & 0x0FFFu;
+		address = at < address ? at : address;
+	}
+
+	alignas(32) uint8_t mask[LANES] = {};
+	uint32_t group = 0;
+	uint16_t opcode = 0;
+
+	for (uint32_t bits = live; bits != 0; bits &= bits - 1)
+	{
+		unsigned int lane = LowestLane(bits);
+
+		if ((pc[lane] & 0x0FFFu) != address)
+		{
+			continue;
+		}
+
+		// Lanes whose copy of the code differs wait for a later step
+		uint16_t laneOpcode = Fetch(machines[lane], address);
+
+		if (group == 0)
+		{
+			opcode = laneOpcode;
+		}
+		else if (laneOpcode != opcode)
+		{
+			continue;
+		}
+
+		group |= 1u << lane;
+		mask[lane] = 0xFF;
+		pc[lane] = address + 2;
+	}
+
+	// Left with pc on a jump to self, as in StepTogether
+	if (Chip8::IsJumpToSelf(opcode, address))
+	{
+		for (uint32_t bits = group; bits != 0; bits &= bits - 1)
+		{
+			unsigned int lane = LowestLane(bits);
+			pc[lane] = address;
+			halts[lane] = HaltReason::JumpToSelf;
+		}
+
+		Stop(group);
+		TryJoin();
+		return;
+	}
+
+	Chip8::Instruction ins = machines[0].Decode(opcode);
+	alignas(32) uint8_t skip[LANES];
+	bool scalar = false;
+
+	if (ExecuteStraight(ins, mask))
+	{
+	}
+	else if (SkipCondition(ins, skip))
+	{
+		alignas(32) uint8_t extra[LANES];
+		Store(extra, And(And(Load(skip), Load(mask)), Splat(2)));
+
+		for (uint32_t bits = group; bits != 0; bits &= bits - 1)
+		{
+			unsigned int lane = LowestLane(bits);
+			pc[lane] += extra[lane];
+		}
+	}
+	else if ((opcode & 0xF000u) == 0x1000u)
+	{
+		for (uint32_t bits = group; bits != 0; bits &= bits - 1)
+		{
+			pc[LowestLane(bits)] = ins.nnn;
+		}
+	}
+	else if ((opcode & 0xF000u) == 0xB000u)
+	{
+		uint8_t const* base = registers[(machines[0].Quirks() & QUIRK_JUMP_VX) != 0 ? ins.x : 0];
+
+		for (uint32_t bits = group; bits != 0; bits &= bits - 1)
+		{
+			unsigned int lane = LowestLane(bits);
+			pc[lane] = base[lane] + ins.nnn;
+		}
+	}
+	else
+	{
+		for (uint32_t bits = group; bits != 0; bits &= bits - 1)
+		{
+			ExecuteScalar(ins, LowestLane(bits));
+		}
+
+		// LD B, Vx, LD [I], Vx and SAVE Vx - Vy may have rewritten code in
+		// some lanes
+		if ((opcode & 0xF0FFu) == 0xF033u || (opcode & 0xF0FFu) == 0xF055u || (opcode & 0xF00Fu) == 0x5002u)
+		{
+			sharedCode = false;
+		}
+
+		scalar = true;
+	}
+
+	uint32_t faulted = 0;
+
+	if (scalar)
+	{
+		for (uint32_t bits = group; bits != 0; bits &= bits - 1)
+		{
+			unsigned int lane = LowestLane(bits);
+
+			if (machines[lane].fault != Chip8Fault::None)
+			{
+				// Counted, but as in Scheduler::Run the frame never ends
+				halts[lane] = HaltReasonOf(machines[lane].fault);
+				faulted |= 1u << lane;
+				++cycles[lane];
+				++frameCycles[lane];
+			}
+		}
+	}
+
+	uint32_t stopped = Count(group & ~faulted, 1);
+	exhausted |= stopped;
+
+	if (scalar)
+	{
+		for (uint32_t bits = group & ~faulted & ~stopped; bits != 0; bits &= bits - 1)
+		{
+			unsigned int lane = LowestLane(bits);
+
+			// Parked until the next Run finds a key down. A lane that also
+			// used up its cycles stops on the limit, like one run alone.
+			if (machines[lane].WaitingForKey())
+			{
+				halts[lane] = HaltReason::WaitForKey;
+				stopped |= 1u << lane;
+			}
+		}
+	}
+
+	Stop(stopped | faulted);
+	TryJoin();
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Vector and Scalar Execution		//
+//											//
+//////////////////////////////////////////////
+
+void Lockstep::ExecuteScalar(Chip8::Instruction const& ins, unsigned int lane)
+{
+	Chip8& chip8 = machines[lane];
+
+	for (unsigned int r = 0; r < 16; ++r)
+	{
+		chip8.registers[r] = registers[r][lane];
+	}
+
+	chip8.pc = pc[lane];
+	chip8.index = index[lane];
+	chip8.delayTimer = delayTimer[lane];
+	chip8.soundTimer = soundTimer[lane];
+
+	(chip8.*(ins.handler))(ins);
+
+	for (unsigned int r = 0; r < 16; ++r)
+	{
+		registers[r][lane] = chip8.registers[r];
+	}
+
+	pc[lane] = chip8.pc;
+	index[lane] = chip8.index;
+	delayTimer[lane] = chip8.delayTimer;
+	soundTimer[lane] = chip8.soundTimer;
+}
+
+bool Lockstep::SkipCondition(Chip8::Instruction const& ins, uint8_t* skip) const
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+
+	// XO-CHIP skips look at the next opcode, the handlers take care of it
+	if (machines[0].Quirks() & QUIRK_XOCHIP)
+	{
+		return false;
+	}
+
+	switch (ins.opcode >> 12u)
+	{
+	case 0x3: Store(skip, Equal(Load(registers[Vx]), Splat(ins.kk))); return true;
+	case 0x4: Store(skip, Not(Equal(Load(registers[Vx]), Splat(ins.kk)))); return true;
+	case 0x5: Store(skip, Equal(Load(registers[Vx]), Load(registers[Vy]))); return true;
+	case 0x9: Store(skip, Not(Equal(Load(registers[Vx]), Load(registers[Vy])))); return true;
+	}
+
+	return false;
+}
+
+// Same results as the Chip8 handlers, including which value VF ends up
+// with when x or y is F: the flag is written first and the result is
+// computed from the registers after that write
+bool Lockstep::ExecuteStraight(Chip8::Instruction const& ins, uint8_t const* mask)
+{
+	uint8_t Vx = ins.x;
+	uint8_t Vy = ins.y;
+	uint8_t shiftSource = (machines[0].Quirks() & QUIRK_SHIFT_VY) != 0 ? Vy : Vx;
+	Lanes active = Load(mask);
+
+	switch (ins.opcode >> 12u)
+	{
+	case 0x6: StoreMasked(registers[Vx], Splat(ins.kk), active); return true;
+	case 0x7: StoreMasked(registers[Vx], Add(Load(registers[Vx]), Splat(ins.kk)), active); return true;
+
+	case 0x8:
+	{
+		switch (ins.n)
+		{
+		case 0x0: StoreMasked(registers[Vx], Load(registers[Vy]), active); return true;
+		case 0x1: StoreMasked(registers[Vx], Or(Load(registers[Vx]), Load(registers[Vy])), active); return true;
+		case 0x2: StoreMasked(registers[Vx], And(Load(registers[Vx]), Load(registers[Vy])), active); return true;
+		case 0x3: StoreMasked(registers[Vx], Xor(Load(registers[Vx]), Load(registers[Vy])), active); return true;
+
+		case 0x4:
+		{
+			Lanes a = Load(registers[Vx]);
+			Lanes b = Load(registers[Vy]);
+			Lanes sum = Add(a, b);
+
+			StoreMasked(registers[0xF], Flag(Not(Equal(AddSaturate(a, b), sum))), active);
+			StoreMasked(registers[Vx], sum, active);
+		}return true;
+
+		case 0x5:
+		{
+			StoreMasked(registers[0xF], Flag(Not(Equal(SubSaturate(Load(registers[Vx]), Load(registers[Vy])), Splat(0)))), active);
+			StoreMasked(registers[Vx], Sub(Load(registers[Vx]), Load(registers[Vy])), active);
+		}return true;
+
+		case 0x6:
+		{
+			StoreMasked(registers[0xF], And(Load(registers[shiftSource]), Splat(1)), active);
+			StoreMasked(registers[Vx], ShiftRight1(Load(registers[shiftSource])), active);
+		}return true;
+
+		case 0x7:
+		{
+			StoreMasked(registers[0xF], Flag(Not(Equal(SubSaturate(Load(registers[Vy]), Load(registers[Vx])), Splat(0)))), active);
+			StoreMasked(registers[Vx], Sub(Load(registers[Vy]), Load(registers[Vx])), active);
+		}return true;
+
+		case 0xE:
+		{
+			StoreMasked(registers[0xF], Flag(Not(Equal(And(Load(registers[shiftSource]), Splat(0x80)), Splat(0)))), active);
+			StoreMasked(registers[Vx], Add(Load(registers[shiftSource]), Load(registers[shiftSource])), active);
+		}return true;
+		}
+	}return false;
+
+	case 0xA:
+	{
+		for (unsigned int lane = 0; lane < LANES; ++lane)
+		{
+			index[lane] = mask[lane] ? ins.nnn : index[lane];
+		}
+	}return true;
+
+	case 0xF:
+	{
+		switch (ins.kk)
+		{
+		case 0x07: StoreMasked(registers[Vx], Load(delayTimer), active); return true;
+		case 0x15: StoreMasked(delayTimer, Load(registers[Vx]), active); return true;
+		case 0x18: StoreMasked(soundTimer, Load(registers[Vx]), active); return true;
+
+		case 0x1E:
+		{
+			for (unsigned int lane = 0; lane < LANES; ++lane)
+			{
+				index[lane] += mask[lane] ? registers[Vx][lane] : 0;
+			}
+		}return true;
+
+		case 0x29:
+		{
+			for (unsigned int lane = 0; lane < LANES; ++lane)
+			{
+				index[lane] = mask[lane] ? static_cast<uint16_t>(FONTSET_START_ADDRESS + (5 * registers[Vx][lane])) : index[lane];
+			}
+		}return true;
+		}
+	}return false;
+	}
+
+	return false;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <cstdint>
+
+// Runs a group of machines side by side, one per byte lane of a vector
+// register. V0-VF, I, pc and the timers are held as one array per field
+// with a slot per lane, so an ALU op or skip taken by every lane at the
+// same pc is a handful of vector instructions. Lanes whose pc differs
+// from the group being run are masked off and get their turn later.
+// Draws, the stack, memory transfers and input fall back to the
+// machine's own handlers, one lane at a time.
+class Lockstep
+{
+public:
+#if defined(__AVX2__)
+	static constexpr unsigned int LANES = 32;
+#else
+	static constexpr unsigned int LANES = 16;
+#endif
+
+	// Lanes run machines[0] to machines[count - 1], count is at most LANES.
+	// The machines stay the source of truth between calls to Run. They must
+	// all share one quirk profile, instructions decode through machines[0].
+	Lockstep(Chip8* machines, unsigned int count);
+
+	void SetInstructionsPerFrame(uint32_t count);
+
+	// Run every lane for up to maxCycles more instructions, ticking each
+	// lane's timers every InstructionsPerFrame of its own instructions.
+	// A lane stops early when it faults, reaches a jump to itself or waits
+	// for a key, on the same cycle and frame as a Scheduler running it
+	// alone; stalled lanes run again on the next call, faulted ones don't.
+	void Run(uint64_t maxCycles);
+
+	unsigned int Count() const { return count; }
+
+	HaltReason Halt(unsigned int lane) const { return halts[lane]; }
+	uint64_t Cycles(unsigned int lane) const { return cycles[lane]; }
+	uint64_t Frames(unsigned int lane) const { return frames[lane]; }
+
+private:
+	void Gather();
+	void Scatter();
+
+	// Run the given lanes until each has executed limit instructions or
+	// halted. Returns the lanes that used up their whole limit.
+	uint32_t RunChunk(uint32_t lanes, uint32_t cycleLimit);
+
+	void StepTogether();
+	void StepApart();
+
+	// Add steps instructions to each lane in lanes, ending frames on the
+	// way. Returns the lanes that reached the limit.
+	uint32_t Count(uint32_t lanes, uint32_t steps);
+	uint32_t UntilEvent() const;
+	void Stop(uint32_t lanes);
+	void Settle();
+	void Split();
+	void TryJoin();
+
+	// Instructions that only touch registers, I and the timers. mask has
+	// 0xFF in the lanes that take part, pc has already been moved past
+	// the instruction. Returns false for anything else.
+	bool ExecuteStraight(Chip8::Instruction const& ins, uint8_t const* mask);
+
+	// For skips, stores 0xFF in every lane whose condition holds
+	bool SkipCondition(Chip8::Instruction const& ins, uint8_t* skip) const;
+	void ExecuteScalar(Chip8::Instruction const& ins, unsigned int lane);
+
+	Chip8* machines;
+	unsigned int count;
+	uint32_t instructionsPerFrame{ 10 };
+	bool sharedCode{};
+
+	alignas(32) uint8_t registers[16][LANES]{};
+	alignas(32) uint8_t delayTimer[LANES]{};
+	alignas(32) uint8_t soundTimer[LANES]{};
+	alignas(32) uint16_t pc[LANES]{};
+	alignas(32) uint16_t index[LANES]{};
+
+	uint64_t cycles[LANES]{};
+	uint64_t frames[LANES]{};
+	uint32_t frameCycles[LANES]{};
+	HaltReason halts[LANES]{};
+
+	// The chunk being run
+	uint32_t live{};
+	uint32_t exhausted{};
+	uint32_t limit{};
+	alignas(32) uint8_t liveMask[LANES]{};
+	uint32_t ran[LANES]{};
+
+	// While together, every live lane sits at sharedPc and pending
+	// instructions have run on all of them since Settle last counted.
+	// untilEvent is how many can run before some lane ends a frame or
+	// reaches the limit.
+	bool together{};
+	uint16_t sharedPc{};
+	uint32_t pending{};
+	uint32_t untilEvent{};
+};
@@ -0,0 +1,114 @@
+#include "Lockstep.h"
+#include "Scheduler.h"
+#include "TestSupport.h"
+
+
+//////////////////////////////////////////////
+//											//
+//	   Lockstep Against One by One Runs		//
+//											//
+//////////////////////////////////////////////
+
+// What BatchRunner::RunToHalt makes of a machine run on its own
+static HaltReason RunAlone(Chip8& chip8, Scheduler& scheduler, uint64_t maxCycles)
+{
+	while (scheduler.Cycles() < maxCycles)
+	{
+		uint32_t chunk = static_cast<uint32_t>(maxCycles - scheduler.Cycles());
+		uint32_t ran = scheduler.Run(chunk);
+
+		if (chip8.fault != Chip8Fault::None)
+		{
+			return HaltReasonOf(chip8.fault);
+		}
+
+		if (ran < chunk)
+		{
+			return chip8.WaitingForKey() ? HaltReason::WaitForKey : HaltReason::JumpToSelf;
+		}
+	}
+
+	return HaltReason::CycleLimit;
+}
+
+// Runs the same machines one by one and in lockstep groups, what each
+// lane reports and every machine must come out the same
+static void ExpectLockstepMatches(QuirkProfile profile, std::vector<std::vector<uint8_t>> const& roms, uint64_t maxCycles)
+{
+	for (size_t first = 0; first < roms.size(); first += Lockstep::LANES)
+	{
+		unsigned int count = static_cast<unsigned int>(roms.size() - first < Lockstep::LANES ? roms.size() - first : Lockstep::LANES);
+		std::vector<Chip8> alone;
+		std::vector<Chip8> lanes;
+		alone.reserve(count);
+		lanes.reserve(count);
+
+		for (unsigned int lane = 0; lane < count; ++lane)
+		{
+			uint64_t seed = first + lane;
+			alone.emplace_back(seed);
+			lanes.emplace_back(seed);
+			alone.back().SetQuirkProfile(profile);
+			lanes.back().SetQuirkProfile(profile);
+			alone.back().LoadROM(roms[first + lane].data(), roms[first + lane].size());
+			lanes.back().LoadROM(roms[first + lane].data(), roms[first + lane].size());
+
+			// Keys held in two lanes out of three
+			alone.back().keypad = lanes.back().keypad = seed % 3 == 0 ? 0 : static_cast<uint16_t>(seed * 0x9E37u);
+		}
+
+		Lockstep lockstep(lanes.data(), count);
+		lockstep.Run(maxCycles);
+
+		for (unsigned int lane = 0; lane < count; ++lane)
+		{
+			Scheduler scheduler(alone[lane]);
+			scheduler.SetMode(Scheduler::Mode::Unthrottled);
+			HaltReason halt = RunAlone(alone[lane], scheduler, maxCycles);
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " instance " << first + lane);
+			EXPECT_EQ(lockstep.Halt(lane), halt);
+			EXPECT_EQ(lockstep.Cycles(lane), scheduler.Cycles());
+			EXPECT_EQ(lockstep.Frames(lane), scheduler.Frames());
+			EXPECT_TRUE(SameState(lanes[lane], alone[lane]));
+		}
+	}
+}
+
+// A different program in every lane, so the lanes rarely run together
+TEST(Lockstep, DifferentRomsMatchScalar)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		std::vector<std::vector<uint8_t>> roms;
+
+		for (uint32_t seed = 0; seed < 300; ++seed)
+		{
+			roms.push_back(RandomRom(seed, profile));
+		}
+
+		ExpectLockstepMatches(profile, roms, 20000);
+	}
+}
+
+// One program with a different seed per lane, the case lockstep is for:
+// the lanes share code and split only where the random numbers differ
+TEST(Lockstep, SharedRomMatchesScalar)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		std::vector<std::vector<uint8_t>> roms;
+
+		for (uint32_t seed = 0; seed < 40; ++seed)
+		{
+			std::vector<uint8_t> rom = RandomRom(seed, profile);
+
+			for (unsigned int lane = 0; lane < Lockstep::LANES; ++lane)
+			{
+				roms.push_back(rom);
+			}
+		}
+
+		ExpectLockstepMatches(profile, roms, 20000);
+	}
+}
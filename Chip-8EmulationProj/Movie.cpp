@@ -0,0 +1,301 @@
+#include "Movie.h"
+#include <cstring>
+
+
+static const uint8_t MOVIE_MAGIC[4] = { 'C', '8', 'M', 'V' };
+static const uint8_t MOVIE_VERSION = 2;
+
+
+//////////////////////////////////////////////
+//											//
+//		   Record Keypad Changes			//
+//											//
+//////////////////////////////////////////////
+
+MovieWriter::~MovieWriter()
+{
+	if (file != nullptr)
+	{
+		Finish(pendingFrame);
+	}
+}
+
+bool MovieWriter::Open(char const* filename, uint64_t seed, uint64_t romHash, uint32_t romSize, uint32_t instructionsPerFrame,
+	QuirkProfile quirkProfile)
+{
+	file = std::fopen(filename, "wb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	failed = false;
+	buffered = 0;
+	lastFrame = pendingFrame = 0;
+	lastKeys = pendingKeys = 0;
+
+	for (uint8_t byte : MOVIE_MAGIC)
+	{
+		Put(byte);
+	}
+
+	Put(MOVIE_VERSION);
+
+	for (unsigned int i = 0; i < 4; ++i) Put(static_cast<uint8_t>(instructionsPerFrame >> (i * 8u)));
+	for (unsigned int i = 0; i < 8; ++i) Put(static_cast<uint8_t>(seed >> (i * 8u)));
+	for (unsigned int i = 0; i < 8; ++i) Put(static_cast<uint8_t>(romHash >> (i * 8u)));
+	for (unsigned int i = 0; i < 4; ++i) Put(static_cast<uint8_t>(romSize >> (i * 8u)));
+	Put(static_cast<uint8_t>(quirkProfile));
+
+	return true;
+}
+
+void MovieWriter::Record(uint64_t frame, uint16_t keypad)
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+
+	// Only the last state of a frame counts, so hold it until a later
+	// frame comes in
+	if (frame > pendingFrame)
+	{
+		FlushPending();
+		pendingFrame = frame;
+	}
+
+	pendingKeys = keypad;
+}
+
+bool MovieWriter::Finish(uint64_t frames)
+{
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	if (pendingFrame < frames)
+	{
+		FlushPending();
+	}
+
+	PutVarint(((frames > lastFrame ? frames - lastFrame : 0) << 1) | 1u);
+	Flush();
+
+	failed |= std::fclose(file) != 0;
+	file = nullptr;
+
+	return !failed;
+}
+
+void MovieWriter::FlushPending()
+{
+	if (pendingKeys == lastKeys)
+	{
+		return;
+	}
+
+	PutVarint((pendingFrame - lastFrame) << 1);
+	Put(static_cast<uint8_t>(pendingKeys));
+	Put(static_cast<uint8_t>(pendingKeys >> 8u));
+
+	lastFrame = pendingFrame;
+	lastKeys = pendingKeys;
+}
+
+void MovieWriter::Put(uint8_t byte)
+{
+	if (buffered == BUFFER_SIZE)
+	{
+		Flush();
+	}
+
+	buffer[buffered++] = byte;
+}
+
+void MovieWriter::PutVarint(uint64_t value)
+{
+	while (value >= 0x80u)
+	{
+		Put(static_cast<uint8_t>(value | 0x80u));
+		value >>= 7u;
+	}
+
+	Put(static_cast<uint8_t>(value));
+}
+
+void MovieWriter::Flush()
+{
+	if (buffered > 0 && std::fwrite(buffer, 1, buffered, file) != buffered)
+	{
+		failed = true;
+	}
+
+	buffered = 0;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Stream a Movie Back In			//
+//											//
+//////////////////////////////////////////////
+
+MoviePlayer::~MoviePlayer()
+{
+	if (file != nullptr)
+	{
+		std::fclose(file);
+	}
+}
+
+bool MoviePlayer::Open(char const* filename)
+{
+	file = std::fopen(filename, "rb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	uint8_t header[29];
+
+	for (uint8_t& byte : header)
+	{
+		if (!Get(byte))
+		{
+			return false;
+		}
+	}
+
+	if (std::memcmp(header, MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) != 0 || header[4] == 0 || header[4] > MOVIE_VERSION)
+	{
+		return false;
+	}
+
+	uint8_t profile = 0;
+
+	if (header[4] >= 2 && (!Get(profile) || profile >= QUIRK_PROFILE_COUNT))
+	{
+		return false;
+	}
+
+	quirkProfile = static_cast<QuirkProfile>(profile);
+
+	instructionsPerFrame = 0;
+	seed = romHash = 0;
+	romSize = 0;
+
+	for (unsigned int i = 0; i < 4; ++i) instructionsPerFrame |= uint32_t(header[5 + i]) << (i * 8u);
+	for (unsigned int i = 0; i < 8; ++i) seed |= uint64_t(header[9 + i]) << (i * 8u);
+	for (unsigned int i = 0; i < 8; ++i) romHash |= uint64_t(header[17 + i]) << (i * 8u);
+	for (unsigned int i = 0; i < 4; ++i) romSize |= uint32_t(header[25 + i]) << (i * 8u);
+
+	keys = 0;
+	nextFrame = 0;
+	truncated = false;
+
+	ReadRecord();
+
+	return true;
+}
+
+bool MoviePlayer::Frame(uint64_t frame, uint16_t& keypad)
+{
+	while (nextFrame <= frame)
+	{
+		if (nextIsEnd)
+		{
+			return false;
+		}
+
+		keys = nextKeys;
+		ReadRecord();
+	}
+
+	keypad = keys;
+
+	return true;
+}
+
+uint64_t MoviePlayer::Play(Chip8& chip8, Scheduler& scheduler)
+{
+	uint64_t first = scheduler.Frames();
+
+	while (Frame(scheduler.Frames() - first, chip8.keypad))
+	{
+		if (scheduler.RunFrames(1) == 0)
+		{
+			break;
+		}
+	}
+
+	return scheduler.Frames() - first;
+}
+
+bool MoviePlayer::ReadRecord()
+{
+	uint64_t value;
+	uint8_t low = 0, high = 0;
+
+	if (!GetVarint(value) || ((value & 1u) == 0 && (!Get(low) || !Get(high))))
+	{
+		// Play what made it to disk and stop there
+		truncated = true;
+		nextIsEnd = true;
+		return false;
+	}
+
+	nextFrame += value >> 1;
+	nextIsEnd = (value & 1u) != 0;
+
+	if (!nextIsEnd)
+	{
+		nextKeys = static_cast<uint16_t>(low | (high << 8u));
+	}
+
+	return true;
+}
+
+bool MoviePlayer::Get(uint8_t& byte)
+{
+	if (position == buffered)
+	{
+		buffered = std::fread(buffer, 1, BUFFER_SIZE, file);
+		position = 0;
+
+		if (buffered == 0)
+		{
+			return false;
+		}
+	}
+
+	byte = buffer[position++];
+	return true;
+}
+
+bool MoviePlayer::GetVarint(uint64_t& value)
+{
+	value = 0;
+
+	for (unsigned int shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t byte;
+
+		if (!Get(byte))
+		{
+			return false;
+		}
+
+		value |= uint64_t(byte & 0x7Fu) << shift;
+
+		if ((byte & 0x80u) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
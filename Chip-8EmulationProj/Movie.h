@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Chip8.h"
+#include "Scheduler.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Movie files record everything a run depends on besides the ROM itself:
+// the RNG seed, the instructions per frame, the quirk profile and every
+// keypad change with the frame it took effect on. Playing one back through
+// a Scheduler gives the same machine state, frame for frame, at any speed.
+//
+// Layout, all integers little-endian:
+//   "C8MV", version byte, uint32 instructions per frame, uint64 seed,
+//   uint64 ROM hash (HashROM), uint32 ROM size, then from version 2 a
+//   QuirkProfile byte (version 1 movies play as Default)
+//   then records of varint (frames since the last record << 1 | end)
+//   followed, unless end is set, by the uint16 keypad mask from that frame
+//   (bit n is key n). The end record's frame is the length of the movie.
+class MovieWriter
+{
+public:
+	MovieWriter() = default;
+	~MovieWriter();
+
+	MovieWriter(MovieWriter const&) = delete;
+	MovieWriter& operator=(MovieWriter const&) = delete;
+
+	bool Open(char const* filename, uint64_t seed, uint64_t romHash, uint32_t romSize, uint32_t instructionsPerFrame,
+		QuirkProfile quirkProfile = QuirkProfile::Default);
+	bool IsOpen() const { return file != nullptr; }
+
+	// The keypad in effect from frame on. Frames must not go backwards;
+	// several calls for the same frame keep the last one.
+	void Record(uint64_t frame, uint16_t keypad);
+
+	// Write the end record and close. Returns false if any write failed.
+	bool Finish(uint64_t frames);
+
+private:
+	static constexpr size_t BUFFER_SIZE = 4096;
+
+	void FlushPending();
+	void Put(uint8_t byte);
+	void PutVarint(uint64_t value);
+	void Flush();
+
+	std::FILE* file{};
+	bool failed{};
+
+	uint8_t buffer[BUFFER_SIZE];
+	size_t buffered{};
+
+	uint64_t lastFrame{};
+	uint16_t lastKeys{};
+	uint64_t pendingFrame{};
+	uint16_t pendingKeys{};
+};
+
+class MoviePlayer
+{
+public:
+	MoviePlayer() = default;
+	~MoviePlayer();
+
+	MoviePlayer(MoviePlayer const&) = delete;
+	MoviePlayer& operator=(MoviePlayer const&) = delete;
+
+	// Reads the header only, records are streamed as playback goes
+	bool Open(char const* filename);
+
+	uint64_t Seed() const { return seed; }
+	uint64_t RomHash() const { return romHash; }
+	uint32_t RomSize() const { return romSize; }
+	uint32_t InstructionsPerFrame() const { return instructionsPerFrame; }
+	QuirkProfile GetQuirkProfile() const { return quirkProfile; }
+
+	// Set keypad for the given frame, asked for in order starting at 0.
+	// Returns false once the movie is over.
+	bool Frame(uint64_t frame, uint16_t& keypad);
+
+	// Run the whole movie, one Scheduler frame per movie frame, as fast as
+	// the host allows. Stops early on a fault. Returns the frames run.
+	uint64_t Play(Chip8& chip8, Scheduler& scheduler);
+
+	// True if the file ended in the middle of a record or without an end
+	bool Truncated() const { return truncated; }
+
+private:
+	static constexpr size_t BUFFER_SIZE = 4096;
+
+	bool Get(uint8_t& byte);
+	bool GetVarint(uint64_t& value);
+	bool ReadRecord();
+
+	std::FILE* file{};
+
+	uint8_t buffer[BUFFER_SIZE];
+	size_t buffered{};
+	size_t position{};
+
+	uint64_t seed{};
+	uint64_t romHash{};
+	uint32_t romSize{};
+	uint32_t instructionsPerFrame{};
+	QuirkProfile quirkProfile{ QuirkProfile::Default };
+
+	// Keys in effect now, and the next change with its frame
+	uint16_t keys{};
+	uint64_t nextFrame{};
+	uint16_t nextKeys{};
+	bool nextIsEnd{};
+	bool truncated{};
+};
@@ -0,0 +1,201 @@
+#include "Platform.h"
+#include <SDL2/SDL.h>
+#include <cstring>
+
+
+// Key 0-F as laid out on the COSMAC VIP's hex keypad
+static const SDL_Scancode DEFAULT_KEY_SCANCODES[16] =
+{
+	SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+	SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+	SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+	SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+};
+
+Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight, bool vsync)
+	: textureWidth(textureWidth), textureHeight(textureHeight)
+{
+	for (unsigned int key = 0; key < 16; ++key)
+	{
+		keyScancodes[key] = DEFAULT_KEY_SCANCODES[key];
+	}
+
+	SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+
+	window = SDL_CreateWindow(title, 0, 0, windowWidth, windowHeight, SDL_WINDOW_SHOWN);
+
+	Uint32 presentFlags = vsync ? SDL_RENDERER_PRESENTVSYNC : 0;
+	renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | presentFlags);
+
+	// No GPU renderer, the caller can scale on the CPU instead
+	if (renderer == nullptr)
+	{
+		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE | presentFlags);
+	}
+
+	SDL_RendererInfo info{};
+	accelerated = renderer != nullptr && SDL_GetRendererInfo(renderer, &info) == 0
+		&& (info.flags & SDL_RENDERER_ACCELERATED) != 0;
+
+	texture = SDL_CreateTexture(
+		renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+}
+
+Platform::~Platform()
+{
+	CloseAudio();
+
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+}
+
+bool Platform::Lock(int first, int count, void*& pixels, int& pitch)
+{
+	if (locked)
+	{
+		SDL_UnlockTexture(texture);
+		locked = false;
+	}
+
+	SDL_Rect rect{ 0, first, textureWidth, count };
+	locked = SDL_LockTexture(texture, &rect, &pixels, &pitch) == 0;
+
+	return locked;
+}
+
+void Platform::Present()
+{
+	if (locked)
+	{
+		SDL_UnlockTexture(texture);
+	}
+	else if (!repaint)
+	{
+		return;
+	}
+
+	locked = false;
+
+	Render();
+}
+
+bool Platform::ResizeTexture(int width, int height)
+{
+	if (locked)
+	{
+		SDL_UnlockTexture(texture);
+		locked = false;
+	}
+
+	SDL_DestroyTexture(texture);
+
+	textureWidth = width;
+	textureHeight = height;
+	texture = SDL_CreateTexture(
+		renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
+
+	return texture != nullptr;
+}
+
+void Platform::Render()
+{
+	repaint = false;
+
+	SDL_RenderClear(renderer);
+	SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+	SDL_RenderPresent(renderer);
+}
+
+bool Platform::ProcessInput(uint16_t& keys)
+{
+	bool quit = false;
+
+	SDL_Event event;
+
+	// Events only matter to the window, keys are read from the state below
+	while (SDL_PollEvent(&event))
+	{
+		switch (event.type)
+		{
+		case SDL_QUIT:
+		{
+			quit = true;
+		}break;
+
+		case SDL_WINDOWEVENT:
+		{
+			if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+			{
+				repaint = true;
+			}
+		}break;
+		}
+	}
+
+	Uint8 const* state = SDL_GetKeyboardState(nullptr);
+
+	keys = 0;
+
+	for (unsigned int key = 0; key < 16; ++key)
+	{
+		keys |= static_cast<uint16_t>((state[keyScancodes[key]] != 0 ? 1u : 0u) << key);
+	}
+
+	rewindHeld = state[SDL_SCANCODE_BACKSPACE] != 0;
+	quit |= state[SDL_SCANCODE_ESCAPE] != 0;
+
+	return quit;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Feed the Audio Device from the Ring	//
+//											//
+//////////////////////////////////////////////
+
+// Runs on SDL's audio thread, the ring is its only link to emulation
+static void AudioCallback(void* userdata, Uint8* stream, int length)
+{
+	SampleRing& ring = *static_cast<SampleRing*>(userdata);
+
+	int16_t* samples = reinterpret_cast<int16_t*>(stream);
+	size_t count = static_cast<size_t>(length) / sizeof(int16_t);
+	size_t popped = ring.Pop(samples, count);
+
+	std::memset(samples + popped, 0, (count - popped) * sizeof(int16_t));
+}
+
+bool Platform::OpenAudio(SampleRing& ring)
+{
+	SDL_AudioSpec want{};
+	want.freq = AudioSynth::SAMPLE_RATE;
+	want.format = AUDIO_S16SYS;
+	want.channels = 1;
+	want.samples = DEVICE_SAMPLES;
+	want.callback = &AudioCallback;
+	want.userdata = &ring;
+
+	SDL_AudioSpec have;
+	audioDevice = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0);
+
+	if (audioDevice == 0)
+	{
+		return false;
+	}
+
+	SDL_PauseAudioDevice(audioDevice, 0);
+
+	return true;
+}
+
+void Platform::CloseAudio()
+{
+	if (audioDevice != 0)
+	{
+		SDL_CloseAudioDevice(audioDevice);
+		audioDevice = 0;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Audio.h"
+#include <cstdint>
+
+struct SDL_Window;
+struct SDL_Renderer;
+struct SDL_Texture;
+
+class Platform
+{
+public:
+	// With vsync, presenting waits for the display's refresh
+	Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight, bool vsync = true);
+	~Platform();
+
+	// Lock count texture rows from first for writing in place, pixels
+	// pointing at row first. Every texel of them must be written before
+	// Present, SDL doesn't keep what was there.
+	bool Lock(int first, int count, void*& pixels, int& pitch);
+
+	// Unlock and present. Does nothing when nothing was locked unless the
+	// window needs repainting.
+	void Present();
+
+	// Replace the texture with one of another size, contents undefined
+	bool ResizeTexture(int width, int height);
+
+	// False on a software renderer, which is slow to stretch textures
+	bool Accelerated() const { return accelerated; }
+
+	// Handle window events and poll the keyboard once, setting bit n of
+	// keys while CHIP-8 key n is held. Returns true when it's time to quit.
+	bool ProcessInput(uint16_t& keys);
+
+	// Bind CHIP-8 key 0-F to an SDL_Scancode. The default layout is the
+	// left of a QWERTY keyboard, 1234/QWER/ASDF/ZXCV.
+	void MapKey(uint8_t key, int scancode) { keyScancodes[key & 0xFu] = scancode; }
+
+	// Start playing what arrives in ring at AudioSynth::SAMPLE_RATE. The
+	// device pulls DEVICE_SAMPLES at a time and plays silence when the
+	// ring runs dry. Returns false if there is no audio device.
+	bool OpenAudio(SampleRing& ring);
+
+	// Stop the device, after which the ring is no longer read
+	void CloseAudio();
+
+	static constexpr unsigned int DEVICE_SAMPLES = 256;
+
+	// Backspace is held down
+	bool RewindHeld() const { return rewindHeld; }
+
+private:
+	void Render();
+
+	SDL_Window* window{};
+	SDL_Renderer* renderer{};
+	SDL_Texture* texture{};
+	int textureWidth;
+	int textureHeight;
+	bool rewindHeld{};
+	bool accelerated{};
+	bool locked{};
+
+	// SDL_Scancode of each CHIP-8 key
+	int keyScancodes[16];
+
+	// SDL_AudioDeviceID, 0 while closed
+	uint32_t audioDevice{};
+
+	// Set when the window was exposed or resized and the last frame has
+	// to be presented again
+	bool repaint{ true };
+};
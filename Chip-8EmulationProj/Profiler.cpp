@@ -0,0 +1,282 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+static char const* const familyNames[Profiler::FAMILY_COUNT] =
+{
+	"CLS", "RET", "JP addr", "CALL addr", "SE Vx, byte", "SNE Vx, byte", "SE Vx, Vy", "LD Vx, byte",
+	"ADD Vx, byte", "LD Vx, Vy", "OR Vx, Vy", "AND Vx, Vy", "XOR Vx, Vy", "ADD Vx, Vy", "SUB Vx, Vy",
+	"SHR Vx", "SUBN Vx, Vy", "SHL Vx", "SNE Vx, Vy", "LD I, addr", "JP V0, addr", "RND Vx, byte",
+	"DRW Vx, Vy, n", "SKP Vx", "SKNP Vx", "LD Vx, DT", "LD Vx, K", "LD DT, Vx", "LD ST, Vx",
+	"ADD I, Vx", "LD F, Vx", "LD B, Vx", "LD [I], Vx", "LD Vx, [I]",
+	"SCD n", "SCU n", "SCR", "SCL", "EXIT", "LOW", "HIGH", "SAVE Vx - Vy", "LOAD Vx - Vy", "LD I, long",
+	"PLANE n", "AUDIO", "LD HF, Vx", "PITCH Vx", "LD R, Vx", "LD Vx, R", "invalid"
+};
+
+static const unsigned int INVALID_FAMILY = Profiler::FAMILY_COUNT - 1;
+
+static unsigned int PopCount(uint64_t bits)
+{
+	unsigned int count = 0;
+
+	for (; bits != 0; bits &= bits - 1)
+	{
+		++count;
+	}
+
+	return count;
+}
+
+
+Profiler::Profiler()
+{
+	Reset();
+}
+
+void Profiler::Reset()
+{
+	std::memset(families, 0, sizeof(families));
+	std::memset(pcCounts, 0, sizeof(pcCounts));
+	std::memset(pcFamilies, 0, sizeof(pcFamilies));
+	std::memset(frameBuckets, 0, sizeof(frameBuckets));
+
+	instructions = 0;
+	draws = drawCollisions = pixelsDrawn = 0;
+
+	frameBusy = Clock::duration::zero();
+	frameStartInstructions = 0;
+
+	frames = 0;
+	totalBusy = Clock::duration::zero();
+	minFrame = Clock::duration::max();
+	maxFrame = Clock::duration::zero();
+	minFrameInstructions = UINT64_MAX;
+	maxFrameInstructions = 0;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Hooks Called by the Core			//
+//											//
+//////////////////////////////////////////////
+
+void Profiler::Instruction(uint16_t pc, uint16_t opcode)
+{
+	unsigned int family = Family(opcode);
+
+	++families[family];
+	++pcCounts[pc & 0x0FFFu];
+	pcFamilies[pc & 0x0FFFu] = static_cast<uint8_t>(family);
+	++instructions;
+}
+
+void Profiler::Draw(uint64_t const* spriteWords, unsigned int words, bool collision)
+{
+	++draws;
+	drawCollisions += collision ? 1 : 0;
+
+	for (unsigned int word = 0; word < words; ++word)
+	{
+		pixelsDrawn += PopCount(spriteWords[word]);
+	}
+}
+
+void Profiler::AddBusyTime(Clock::duration time)
+{
+	frameBusy += time;
+}
+
+void Profiler::EndFrame()
+{
+	uint64_t frameInstructions = instructions - frameStartInstructions;
+	uint64_t micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(frameBusy).count());
+
+	unsigned int bucket = 0;
+
+	while (bucket + 1 < FRAME_BUCKETS && (micros >> bucket) > 1)
+	{
+		++bucket;
+	}
+
+	++frameBuckets[bucket];
+	++frames;
+
+	totalBusy += frameBusy;
+	minFrame = std::min(minFrame, frameBusy);
+	maxFrame = std::max(maxFrame, frameBusy);
+	minFrameInstructions = std::min(minFrameInstructions, frameInstructions);
+	maxFrameInstructions = std::max(maxFrameInstructions, frameInstructions);
+
+	frameBusy = Clock::duration::zero();
+	frameStartInstructions = instructions;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		 Opcode Families for Reporting		//
+//											//
+//////////////////////////////////////////////
+
+unsigned int Profiler::Family(uint16_t opcode)
+{
+	unsigned int x = opcode >> 12u;
+	unsigned int n = opcode & 0x000Fu;
+	unsigned int kk = opcode & 0x00FFu;
+
+	switch (x)
+	{
+	case 0x0:
+	{
+		switch (opcode)
+		{
+		case 0x00E0: return 0;
+		case 0x00EE: return 1;
+		case 0x00FB: return 36;
+		case 0x00FC: return 37;
+		case 0x00FD: return 38;
+		case 0x00FE: return 39;
+		case 0x00FF: return 40;
+		}
+
+		return (opcode & 0xFFF0u) == 0x00C0u ? 34 : (opcode & 0xFFF0u) == 0x00D0u ? 35 : INVALID_FAMILY;
+	}
+	case 0x1: return 2;
+	case 0x2: return 3;
+	case 0x3: return 4;
+	case 0x4: return 5;
+	case 0x5: return n == 0 ? 6 : n == 2 ? 41 : n == 3 ? 42 : INVALID_FAMILY;
+	case 0x6: return 7;
+	case 0x7: return 8;
+	case 0x8: return n <= 0x7u ? 9 + n : n == 0xEu ? 17 : INVALID_FAMILY;
+	case 0x9: return n == 0 ? 18 : INVALID_FAMILY;
+	case 0xA: return 19;
+	case 0xB: return 20;
+	case 0xC: return 21;
+	case 0xD: return 22;
+	case 0xE: return kk == 0x9Eu ? 23 : kk == 0xA1u ? 24 : INVALID_FAMILY;
+	}
+
+	switch (kk)
+	{
+	case 0x07: return 25;
+	case 0x0A: return 26;
+	case 0x15: return 27;
+	case 0x18: return 28;
+	case 0x1E: return 29;
+	case 0x29: return 30;
+	case 0x33: return 31;
+	case 0x55: return 32;
+	case 0x65: return 33;
+	case 0x00: return 43;
+	case 0x01: return 44;
+	case 0x02: return 45;
+	case 0x30: return 46;
+	case 0x3A: return 47;
+	case 0x75: return 48;
+	case 0x85: return 49;
+	}
+
+	return INVALID_FAMILY;
+}
+
+char const* Profiler::FamilyName(unsigned int family)
+{
+	return family < FAMILY_COUNT ? familyNames[family] : "unknown";
+}
+
+
+//////////////////////////////////////////////
+//											//
+//			   Write the Results			//
+//											//
+//////////////////////////////////////////////
+
+bool Profiler::WriteJson(std::FILE* file) const
+{
+	auto toMicros = [](Clock::duration time)
+	{
+		return std::chrono::duration<double, std::micro>(time).count();
+	};
+
+	std::fprintf(file, "{\n\t\"instructions\": %llu,\n", static_cast<unsigned long long>(instructions));
+
+	std::fprintf(file, "\t\"families\": {");
+	bool first = true;
+
+	for (unsigned int family = 0; family < FAMILY_COUNT; ++family)
+	{
+		if (families[family] != 0)
+		{
+			std::fprintf(file, "%s\n\t\t\"%s\": %llu", first ? "" : ",", familyNames[family], static_cast<unsigned long long>(families[family]));
+			first = false;
+		}
+	}
+
+	std::fprintf(file, "\n\t},\n");
+
+	// Hottest first
+	std::vector<uint16_t> pcs;
+
+	for (uint16_t pc = 0; pc < 4096; ++pc)
+	{
+		if (pcCounts[pc] != 0)
+		{
+			pcs.push_back(pc);
+		}
+	}
+
+	std::stable_sort(pcs.begin(), pcs.end(), [this](uint16_t a, uint16_t b) { return pcCounts[a] > pcCounts[b]; });
+
+	std::fprintf(file, "\t\"pcs\": [");
+
+	for (size_t i = 0; i < pcs.size(); ++i)
+	{
+		std::fprintf(file, "%s\n\t\t{ \"pc\": \"0x%03X\", \"family\": \"%s\", \"count\": %llu }", i == 0 ? "" : ",",
+			pcs[i], familyNames[pcFamilies[pcs[i]]], static_cast<unsigned long long>(pcCounts[pcs[i]]));
+	}
+
+	std::fprintf(file, "\n\t],\n");
+
+	std::fprintf(file, "\t\"draws\": { \"calls\": %llu, \"collisions\": %llu, \"pixels\": %llu },\n",
+		static_cast<unsigned long long>(draws), static_cast<unsigned long long>(drawCollisions), static_cast<unsigned long long>(pixelsDrawn));
+
+	std::fprintf(file, "\t\"frames\": {\n\t\t\"count\": %llu,\n", static_cast<unsigned long long>(frames));
+
+	if (frames > 0)
+	{
+		std::fprintf(file, "\t\t\"busy_us\": { \"min\": %.3f, \"mean\": %.3f, \"max\": %.3f },\n",
+			toMicros(minFrame), toMicros(totalBusy) / frames, toMicros(maxFrame));
+		std::fprintf(file, "\t\t\"instructions\": { \"min\": %llu, \"max\": %llu },\n",
+			static_cast<unsigned long long>(minFrameInstructions), static_cast<unsigned long long>(maxFrameInstructions));
+	}
+
+	// Bucket n counts frames that took 2^n up to 2^(n+1) microseconds,
+	// bucket 0 also takes anything faster
+	std::fprintf(file, "\t\t\"busy_us_log2_histogram\": [");
+
+	for (unsigned int bucket = 0; bucket < FRAME_BUCKETS; ++bucket)
+	{
+		std::fprintf(file, "%s%llu", bucket == 0 ? "" : ", ", static_cast<unsigned long long>(frameBuckets[bucket]));
+	}
+
+	std::fprintf(file, "]\n\t}\n}\n");
+
+	return std::ferror(file) == 0;
+}
+
+bool Profiler::WriteFolded(std::FILE* file) const
+{
+	for (unsigned int pc = 0; pc < 4096; ++pc)
+	{
+		if (pcCounts[pc] != 0)
+		{
+			std::fprintf(file, "chip8;%s;0x%03X %llu\n", familyNames[pcFamilies[pc]], pc, static_cast<unsigned long long>(pcCounts[pc]));
+		}
+	}
+
+	return std::ferror(file) == 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Where a program spends its time: instructions per opcode family, per
+// pc, what DRW put on screen and how long frames took to emulate. Attach
+// one with Chip8::SetProfiler; Cycle, Run and the Scheduler report to it.
+// The JIT steps aside while one is attached and Lockstep doesn't report.
+//
+// Builds without CHIP8_PROFILING drop every hook at compile time.
+class Profiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// Every handler in the dispatch tables plus one for invalid opcodes
+	static constexpr unsigned int FAMILY_COUNT = 51;
+
+	// Frame times are bucketed by powers of two microseconds
+	static constexpr unsigned int FRAME_BUCKETS = 24;
+
+	Profiler();
+
+	void Reset();
+
+	// Hooks
+	void Instruction(uint16_t pc, uint16_t opcode);
+	void Draw(uint64_t const* spriteWords, unsigned int words, bool collision);
+	void AddBusyTime(Clock::duration time);
+	void EndFrame();
+
+	// Counts per family, the most executed pcs and frame statistics
+	bool WriteJson(std::FILE* file) const;
+
+	// One "chip8;<family>;<pc> <count>" line per pc, the stack-collapsed
+	// input flamegraph.pl and speedscope take. The family is whatever ran
+	// at that pc last, self-modifying code may have run others there.
+	bool WriteFolded(std::FILE* file) const;
+
+	static unsigned int Family(uint16_t opcode);
+	static char const* FamilyName(unsigned int family);
+
+	uint64_t Instructions() const { return instructions; }
+	uint64_t FamilyCount(unsigned int family) const { return families[family]; }
+	uint64_t PcCount(uint16_t pc) const { return pcCounts[pc & 0x0FFFu]; }
+	uint64_t Draws() const { return draws; }
+	uint64_t PixelsDrawn() const { return pixelsDrawn; }
+	uint64_t Frames() const { return frames; }
+
+private:
+	uint64_t families[FAMILY_COUNT];
+	uint64_t pcCounts[4096];
+	uint8_t pcFamilies[4096];
+	uint64_t instructions;
+
+	uint64_t draws;
+	uint64_t drawCollisions;
+	uint64_t pixelsDrawn;
+
+	// Time spent emulating, not waiting, during the frame in progress
+	Clock::duration frameBusy;
+	uint64_t frameStartInstructions;
+
+	uint64_t frames;
+	Clock::duration totalBusy;
+	Clock::duration minFrame;
+	Clock::duration maxFrame;
+	uint64_t minFrameInstructions;
+	uint64_t maxFrameInstructions;
+	uint64_t frameBuckets[FRAME_BUCKETS];
+};
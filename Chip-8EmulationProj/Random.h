@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+// Cxkk pulls its bytes from a RandomFunc. The whole generator state is the
+// one word it is handed, which lives in Chip8State, so snapshots, rewind
+// and replays reproduce the same numbers. Each call yields 64 bits, which
+// covers eight Cxkk.
+typedef uint64_t (*RandomFunc)(uint64_t& state);
+
+// Used to turn a seed into a starting state, also usable as a generator
+inline uint64_t SplitMix64(uint64_t& state)
+{
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30u)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27u)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31u);
+}
+
+// The default. State must never be zero.
+inline uint64_t XorShift64Star(uint64_t& state)
+{
+	state ^= state >> 12u;
+	state ^= state << 25u;
+	state ^= state >> 27u;
+	return state * 0x2545F4914F6CDD1Dull;
+}
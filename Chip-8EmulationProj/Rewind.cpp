@@ -0,0 +1,273 @@
+#include "Rewind.h"
+#include <cstring>
+
+
+// Literal runs end at this many zero bytes in a row, shorter gaps are
+// cheaper to copy than to encode as a new run
+static const size_t MIN_ZERO_RUN = 4;
+
+static uint8_t* WriteVarint(uint8_t* out, size_t value)
+{
+	while (value >= 0x80u)
+	{
+		*out++ = static_cast<uint8_t>(value | 0x80u);
+		value >>= 7u;
+	}
+
+	*out++ = static_cast<uint8_t>(value);
+	return out;
+}
+
+static uint8_t const* ReadVarint(uint8_t const* in, size_t& value)
+{
+	value = 0;
+
+	for (unsigned int shift = 0;; shift += 7)
+	{
+		uint8_t byte = *in++;
+		value |= static_cast<size_t>(byte & 0x7Fu) << shift;
+
+		if ((byte & 0x80u) == 0)
+		{
+			return in;
+		}
+	}
+}
+
+
+RewindBuffer::RewindBuffer(size_t capacityBytes)
+	: ring(capacityBytes), scratch(2 * sizeof(Chip8State) + 32)
+{
+}
+
+void RewindBuffer::Clear()
+{
+	start = 0;
+	used = 0;
+	frames = 0;
+	hasHead = false;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  XOR and Run-Length Encode a Frame		//
+//											//
+//////////////////////////////////////////////
+
+// Output is a list of (zero run, literal length, literal bytes) where the
+// literals are the XOR of the two states
+size_t RewindBuffer::Encode(uint8_t const* older, uint8_t const* newer, size_t size, uint8_t* out) const
+{
+	uint8_t* begin = out;
+	size_t pos = 0;
+
+	while (pos < size)
+	{
+		size_t zeroStart = pos;
+
+		// Skip unchanged bytes a word at a time while we can
+		while (pos + 8 <= size)
+		{
+			uint64_t a;
+			uint64_t b;
+			std::memcpy(&a, older + pos, 8);
+			std::memcpy(&b, newer + pos, 8);
+
+			if (a != b)
+			{
+				break;
+			}
+
+			pos += 8;
+		}
+
+		while (pos < size && older[pos] == newer[pos])
+		{
+			++pos;
+		}
+
+		size_t literalStart = pos;
+		size_t zeros = 0;
+
+		while (pos < size && zeros < MIN_ZERO_RUN)
+		{
+			zeros = older[pos] == newer[pos] ? zeros + 1 : 0;
+			++pos;
+		}
+
+		// Give back the zeros that ended the literal to the next run
+		if (zeros == MIN_ZERO_RUN)
+		{
+			pos -= zeros;
+		}
+
+		size_t literalLength = pos - literalStart;
+
+		out = WriteVarint(out, literalStart - zeroStart);
+		out = WriteVarint(out, literalLength);
+
+		for (size_t i = literalStart; i < pos; ++i)
+		{
+			*out++ = older[i] ^ newer[i];
+		}
+	}
+
+	return static_cast<size_t>(out - begin);
+}
+
+uint8_t const* RewindBuffer::Apply(uint8_t const* delta, size_t size, uint8_t* state) const
+{
+	size_t pos = 0;
+
+	// The runs of a segment always add up to exactly its size
+	while (pos < size)
+	{
+		size_t zeroRun;
+		size_t literalLength;
+
+		delta = ReadVarint(delta, zeroRun);
+		delta = ReadVarint(delta, literalLength);
+
+		pos += zeroRun;
+
+		for (size_t i = 0; i < literalLength; ++i)
+		{
+			state[pos++] ^= *delta++;
+		}
+	}
+
+	return delta;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		 Byte Ring of Framed Records		//
+//											//
+//////////////////////////////////////////////
+
+void RewindBuffer::WriteRing(size_t offset, void const* data, size_t length)
+{
+	offset %= ring.size();
+	size_t first = length < ring.size() - offset ? length : ring.size() - offset;
+
+	std::memcpy(&ring[offset], data, first);
+	std::memcpy(&ring[0], static_cast<uint8_t const*>(data) + first, length - first);
+}
+
+void RewindBuffer::ReadRing(size_t offset, void* data, size_t length) const
+{
+	offset %= ring.size();
+	size_t first = length < ring.size() - offset ? length : ring.size() - offset;
+
+	std::memcpy(data, &ring[offset], first);
+	std::memcpy(static_cast<uint8_t*>(data) + first, &ring[0], length - first);
+}
+
+void RewindBuffer::Push(uint8_t const* data, uint32_t length)
+{
+	size_t recordSize = length + RECORD_OVERHEAD;
+
+	// A delta bigger than the whole ring means no history can be kept
+	if (recordSize > ring.size())
+	{
+		start = 0;
+		used = 0;
+		frames = 0;
+		return;
+	}
+
+	while (used + recordSize > ring.size())
+	{
+		DropOldest();
+	}
+
+	size_t offset = start + used;
+
+	WriteRing(offset, &length, sizeof(length));
+	WriteRing(offset + sizeof(length), data, length);
+	WriteRing(offset + sizeof(length) + length, &length, sizeof(length));
+
+	used += recordSize;
+	++frames;
+}
+
+uint32_t RewindBuffer::PopNewest(uint8_t* data)
+{
+	uint32_t length;
+	ReadRing(start + used - sizeof(length), &length, sizeof(length));
+	ReadRing(start + used - sizeof(length) - length, data, length);
+
+	used -= length + RECORD_OVERHEAD;
+	--frames;
+
+	return length;
+}
+
+void RewindBuffer::DropOldest()
+{
+	uint32_t length;
+	ReadRing(start, &length, sizeof(length));
+
+	start = (start + length + RECORD_OVERHEAD) % ring.size();
+	used -= length + RECORD_OVERHEAD;
+	--frames;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		  Record and Step Back Frames		//
+//											//
+//////////////////////////////////////////////
+
+void RewindBuffer::Record(Chip8 const& chip8)
+{
+	if (ring.empty())
+	{
+		return;
+	}
+
+	size_t extendedSize = chip8.ExtendedMemorySize();
+
+	// Switching to or from XO-CHIP changes what a frame holds, history
+	// from before can't be applied any more
+	if (extendedSize != headExtended.size())
+	{
+		Clear();
+		headExtended.assign(extendedSize, 0);
+		nextExtended.assign(extendedSize, 0);
+		scratch.resize(2 * (sizeof(Chip8State) + extendedSize) + 32);
+	}
+
+	chip8.SaveState(next, nextExtended.data());
+
+	// The state's runs, then the extended memory's when there is any
+	if (hasHead)
+	{
+		size_t length = Encode(reinterpret_cast<uint8_t const*>(&head), reinterpret_cast<uint8_t const*>(&next), sizeof(Chip8State), scratch.data());
+		length += Encode(headExtended.data(), nextExtended.data(), extendedSize, scratch.data() + length);
+		Push(scratch.data(), static_cast<uint32_t>(length));
+	}
+
+	head = next;
+	headExtended.swap(nextExtended);
+	hasHead = true;
+}
+
+bool RewindBuffer::Rewind(Chip8& chip8)
+{
+	if (frames == 0 || chip8.ExtendedMemorySize() != headExtended.size())
+	{
+		return false;
+	}
+
+	PopNewest(scratch.data());
+
+	uint8_t const* delta = Apply(scratch.data(), sizeof(Chip8State), reinterpret_cast<uint8_t*>(&head));
+	Apply(delta, headExtended.size(), headExtended.data());
+
+	chip8.LoadState(head, headExtended.data());
+	return true;
+}
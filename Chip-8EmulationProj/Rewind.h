@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Always-on rewind history in a fixed amount of memory. Only the newest
+// state is kept whole; every older frame is stored as the XOR of itself
+// and the frame after it, run-length encoded so unchanged memory and video
+// cost a few bytes. Stepping back XORs the newest delta into the kept
+// state. When the ring is full the oldest deltas are dropped. XO-CHIP's
+// memory past 4 KB is kept and compared only while that profile runs.
+class RewindBuffer
+{
+public:
+	explicit RewindBuffer(size_t capacityBytes);
+
+	// Call once per frame
+	void Record(Chip8 const& chip8);
+
+	// Step back one recorded frame. Returns false when there is no history.
+	bool Rewind(Chip8& chip8);
+
+	void Clear();
+
+	// Number of frames Rewind can still step back
+	size_t Frames() const { return frames; }
+	size_t BytesUsed() const { return used; }
+	size_t Capacity() const { return ring.size(); }
+
+private:
+	// Each record is framed by its length on both ends so it can be
+	// dropped from the old end and popped from the new end
+	static const size_t RECORD_OVERHEAD = 2 * sizeof(uint32_t);
+
+	void Push(uint8_t const* data, uint32_t length);
+	uint32_t PopNewest(uint8_t* data);
+	void DropOldest();
+
+	void WriteRing(size_t offset, void const* data, size_t length);
+	void ReadRing(size_t offset, void* data, size_t length) const;
+
+	size_t Encode(uint8_t const* older, uint8_t const* newer, size_t size, uint8_t* out) const;
+
+	// Applies one Encode of size bytes and returns where the next begins
+	uint8_t const* Apply(uint8_t const* delta, size_t size, uint8_t* state) const;
+
+	std::vector<uint8_t> ring;
+	size_t start{};
+	size_t used{};
+	size_t frames{};
+
+	// The newest recorded state and scratch space, allocated once
+	bool hasHead{};
+	Chip8State head;
+	Chip8State next;
+	std::vector<uint8_t> headExtended;
+	std::vector<uint8_t> nextExtended;
+	std::vector<uint8_t> scratch;
+};
@@ -0,0 +1,127 @@
+#include "Rewind.h"
+#include "Scheduler.h"
+#include "TestSupport.h"
+
+
+//////////////////////////////////////////////
+//											//
+//		  Rewinding to Recorded Frames		//
+//											//
+//////////////////////////////////////////////
+
+// Every frame's state as Record saw it
+struct SavedFrames
+{
+	std::vector<Chip8State> states;
+	std::vector<std::vector<uint8_t>> extended;
+
+	void Save(Chip8 const& chip8)
+	{
+		states.emplace_back();
+		extended.emplace_back(chip8.ExtendedMemorySize());
+		chip8.SaveState(states.back(), extended.back().data());
+	}
+
+	void Drop()
+	{
+		states.pop_back();
+		extended.pop_back();
+	}
+};
+
+// Runs and records up to frameCount frames, stopping early on a fault
+static void RecordFrames(Chip8& chip8, Scheduler& scheduler, RewindBuffer& rewind, SavedFrames& saved, unsigned int frameCount)
+{
+	for (unsigned int frame = 0; frame < frameCount && scheduler.RunFrames(1) == 1; ++frame)
+	{
+		rewind.Record(chip8);
+		saved.Save(chip8);
+	}
+}
+
+// Steps back count frames, each time to the frame recorded before
+static void ExpectRewindsMatch(Chip8& chip8, RewindBuffer& rewind, SavedFrames& saved, QuirkProfile profile, size_t count)
+{
+	Chip8 expected;
+	expected.SetQuirkProfile(profile);
+
+	for (size_t step = 0; step < count; ++step)
+	{
+		ASSERT_TRUE(rewind.Rewind(chip8));
+		saved.Drop();
+
+		expected.LoadState(saved.states.back(), saved.extended.back().data());
+
+		SCOPED_TRACE(::testing::Message() << "frame " << saved.states.size() - 1);
+		ASSERT_TRUE(SameState(chip8, expected));
+	}
+}
+
+// Back through a whole run to the first frame recorded, with a detour:
+// rewinding partway and running on replaces the history after that point
+TEST(Rewind, StepsBackToEveryRecordedFrame)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 40; ++seed)
+		{
+			Chip8 chip8{ seed };
+			LoadRandomRom(chip8, seed, profile);
+			chip8.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			Scheduler scheduler(chip8);
+			scheduler.SetMode(Scheduler::Mode::Unthrottled);
+			RewindBuffer rewind(1024 * 1024);
+			SavedFrames saved;
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+
+			// The loaded machine too, some programs fault in their first frame
+			rewind.Record(chip8);
+			saved.Save(chip8);
+
+			RecordFrames(chip8, scheduler, rewind, saved, 120);
+			ASSERT_EQ(rewind.Frames() + 1, saved.states.size());
+			ExpectRewindsMatch(chip8, rewind, saved, profile, rewind.Frames() / 2);
+
+			chip8.keypad = static_cast<uint16_t>(~chip8.keypad);
+			RecordFrames(chip8, scheduler, rewind, saved, 60);
+			ASSERT_EQ(rewind.Frames() + 1, saved.states.size());
+			ExpectRewindsMatch(chip8, rewind, saved, profile, rewind.Frames());
+
+			EXPECT_FALSE(rewind.Rewind(chip8));
+		}
+	}
+}
+
+// A ring too small for the whole run keeps the newest frames, and those
+// still rewind exactly
+TEST(Rewind, FullRingKeepsTheNewestFrames)
+{
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 40; ++seed)
+		{
+			Chip8 chip8{ seed };
+			LoadRandomRom(chip8, seed, profile);
+			chip8.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			Scheduler scheduler(chip8);
+			scheduler.SetMode(Scheduler::Mode::Unthrottled);
+			RewindBuffer rewind(4 * 1024);
+			SavedFrames saved;
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+
+			// The loaded machine too, some programs fault in their first frame
+			rewind.Record(chip8);
+			saved.Save(chip8);
+
+			RecordFrames(chip8, scheduler, rewind, saved, 300);
+			ASSERT_LE(rewind.Frames() + 1, saved.states.size());
+			ExpectRewindsMatch(chip8, rewind, saved, profile, rewind.Frames());
+
+			EXPECT_FALSE(rewind.Rewind(chip8));
+		}
+	}
+}
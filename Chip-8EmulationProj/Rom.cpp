@@ -0,0 +1,169 @@
+#include "Rom.h"
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//////////////////////////////////////////////
+//											//
+//		   Map a ROM File Read-Only			//
+//											//
+//////////////////////////////////////////////
+
+RomImage::~RomImage()
+{
+	Unmap();
+}
+
+bool RomImage::Map(char const* filename, size_t maxSize)
+{
+	Unmap();
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0 || fileSize.QuadPart > static_cast<LONGLONG>(maxSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// The view keeps the file open, the handles can go
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+
+	if (mapping == nullptr)
+	{
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		mapping = nullptr;
+		return false;
+	}
+
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int file = open(filename, O_RDONLY);
+
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+
+	if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0 || info.st_size > static_cast<off_t>(maxSize))
+	{
+		close(file);
+		return false;
+	}
+
+	// The mapping keeps its own reference to the file
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+
+	size = static_cast<size_t>(info.st_size);
+#endif
+
+	data = static_cast<uint8_t const*>(view);
+	hash = HashROM(data, size);
+
+	return true;
+}
+
+void RomImage::Unmap()
+{
+	if (data == nullptr)
+	{
+		return;
+	}
+
+#if defined(_WIN32)
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+	mapping = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+	hash = 0;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		  Share Images Between Machines		//
+//											//
+//////////////////////////////////////////////
+
+std::shared_ptr<RomImage const> OpenROM(char const* filename, QuirkProfile profile)
+{
+	const size_t maxSize = MaxRomSizeOf(profile);
+
+	static std::mutex mutex;
+	static std::unordered_map<std::string, std::weak_ptr<RomImage const>> cache;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::weak_ptr<RomImage const>& entry = cache[filename];
+	std::shared_ptr<RomImage const> image = entry.lock();
+
+	// Mapped for another profile, which may allow more than this one
+	if (image)
+	{
+		return image->Size() <= maxSize ? image : nullptr;
+	}
+
+	std::shared_ptr<RomImage> mapped = std::make_shared<RomImage>();
+
+	if (!mapped->Map(filename, maxSize))
+	{
+		cache.erase(filename);
+		return nullptr;
+	}
+
+	entry = mapped;
+
+	return mapped;
+}
+
+uint64_t HashROM(uint8_t const* data, size_t size)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+}
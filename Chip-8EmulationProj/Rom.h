@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Room for a program between START_ADDRESS and the end of the memory the
+// profile can address, so only XO-CHIP ROMs may run past 4 KB
+constexpr size_t MaxRomSizeOf(QuirkProfile profile)
+{
+	return AddressMaskOf(QuirksOf(profile)) + 1u - START_ADDRESS;
+}
+
+// A ROM file mapped read-only into the address space. Nothing is copied
+// until a machine loads it, and every machine loading the same image
+// reads the same pages.
+class RomImage
+{
+public:
+	RomImage() = default;
+	~RomImage();
+
+	RomImage(RomImage const&) = delete;
+	RomImage& operator=(RomImage const&) = delete;
+
+	// Fails if the file can't be opened or mapped, is empty or is larger
+	// than maxSize
+	bool Map(char const* filename, size_t maxSize);
+
+	uint8_t const* Data() const { return data; }
+	size_t Size() const { return size; }
+
+	// HashROM of the contents, taken once when mapped
+	uint64_t Hash() const { return hash; }
+
+private:
+	void Unmap();
+
+	uint8_t const* data{};
+	size_t size{};
+	uint64_t hash{};
+
+#if defined(_WIN32)
+	void* mapping{};
+#endif
+};
+
+// Map a ROM through a process-wide cache keyed by path, so everything
+// running the same file shares one image. The image stays mapped while
+// anyone holds it. Returns null if Map fails or the file is too large for
+// the profile. Safe to call from any thread.
+std::shared_ptr<RomImage const> OpenROM(char const* filename, QuirkProfile profile = QuirkProfile::Default);
+
+// 64-bit FNV-1a of the ROM image, identifies the program in movie files
+uint64_t HashROM(uint8_t const* data, size_t size);
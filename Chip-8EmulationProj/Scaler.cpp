@@ -0,0 +1,343 @@
+#include "Scaler.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#define CHIP8_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHIP8_SSE2 1
+#include <emmintrin.h>
+#endif
+
+
+//////////////////////////////////////////////
+//											//
+//		  Filters and Palettes by Name		//
+//											//
+//////////////////////////////////////////////
+
+static const uint32_t AMBER_PALETTE[1u << VIDEO_PLANES] = { 0x140C00FF, 0xFFB000FF, 0xB07A00FF, 0xFFD880FF };
+static const uint32_t GREEN_PALETTE[1u << VIDEO_PLANES] = { 0x001400FF, 0x33FF66FF, 0x1F9940FF, 0xA8FFB8FF };
+static const uint32_t LCD_PALETTE[1u << VIDEO_PLANES] = { 0x9BBC0FFF, 0x0F380FFF, 0x306230FF, 0x6B8C0FFF };
+static const uint32_t CGA_PALETTE[1u << VIDEO_PLANES] = { 0x000000FF, 0x55FFFFFF, 0xFF55FFFF, 0xFFFFFFFF };
+
+struct NamedPalette
+{
+	char const* name;
+	uint32_t const* colors;
+};
+
+static const NamedPalette PALETTES[] =
+{
+	{ "default", DEFAULT_PALETTE },
+	{ "amber", AMBER_PALETTE },
+	{ "green", GREEN_PALETTE },
+	{ "lcd", LCD_PALETTE },
+	{ "cga", CGA_PALETTE }
+};
+
+char const* ScaleFilterName(ScaleFilter filter)
+{
+	switch (filter)
+	{
+	case ScaleFilter::None: return "none";
+	case ScaleFilter::Scanlines: return "scanlines";
+	case ScaleFilter::Grid: return "grid";
+	case ScaleFilter::Count: break;
+	}
+
+	return "unknown";
+}
+
+bool ParseScaleFilter(char const* name, ScaleFilter& filter)
+{
+	for (unsigned int i = 0; i < static_cast<unsigned int>(ScaleFilter::Count); ++i)
+	{
+		if (std::strcmp(name, ScaleFilterName(static_cast<ScaleFilter>(i))) == 0)
+		{
+			filter = static_cast<ScaleFilter>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ParsePalette(char const* name, uint32_t const*& palette)
+{
+	for (NamedPalette const& named : PALETTES)
+	{
+		if (std::strcmp(name, named.name) == 0)
+		{
+			palette = named.colors;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Expand One Row of Pixels			//
+//											//
+//////////////////////////////////////////////
+
+// One pixel's run of block texels, the last of which is edge
+static inline void FillBlock(uint32_t color, uint32_t edge, unsigned int block, uint32_t* out)
+{
+	unsigned int texel = 0;
+
+#if defined(CHIP8_SSE2)
+	__m128i fill = _mm_set1_epi32(static_cast<int>(color));
+
+	for (; texel + 4 < block; texel += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + texel), fill);
+	}
+#endif
+
+	for (; texel + 1 < block; ++texel)
+	{
+		out[texel] = color;
+	}
+
+	out[block - 1] = edge;
+}
+
+// columns pixels from the row's words, most significant bit first, each
+// becoming block texels of bright with the last one edge
+static void ExpandRow(uint64_t const (&words)[VIDEO_PLANES][VIDEO_STRIPS], unsigned int columns, unsigned int block,
+	uint32_t const* bright, uint32_t const* edge, uint32_t* out)
+{
+	unsigned int column = 0;
+
+	// Broadcast the pixels' bits across the lanes, keep the lane's own bit
+	// as a mask and pick the color with it
+#if defined(CHIP8_AVX2)
+	const __m256i LANE_BITS = _mm256_set_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+
+	__m256i bright0 = _mm256_set1_epi32(static_cast<int>(bright[0]));
+	__m256i bright1 = _mm256_set1_epi32(static_cast<int>(bright[1]));
+	__m256i bright2 = _mm256_set1_epi32(static_cast<int>(bright[2]));
+	__m256i bright3 = _mm256_set1_epi32(static_cast<int>(bright[3]));
+	__m256i edge0 = _mm256_set1_epi32(static_cast<int>(edge[0]));
+	__m256i edge1 = _mm256_set1_epi32(static_cast<int>(edge[1]));
+	__m256i edge2 = _mm256_set1_epi32(static_cast<int>(edge[2]));
+	__m256i edge3 = _mm256_set1_epi32(static_cast<int>(edge[3]));
+
+	for (; column + 8 <= columns; column += 8)
+	{
+		unsigned int shift = 56u - (column & 63u);
+		unsigned int strip = column >> 6u;
+
+		__m256i bits0 = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>((words[0][strip] >> shift) & 0xFFu)), LANE_BITS);
+		__m256i bits1 = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>((words[1][strip] >> shift) & 0xFFu)), LANE_BITS);
+		__m256i plane0 = _mm256_cmpeq_epi32(bits0, LANE_BITS);
+		__m256i plane1 = _mm256_cmpeq_epi32(bits1, LANE_BITS);
+
+		__m256i color = _mm256_blendv_epi8(
+			_mm256_blendv_epi8(bright0, bright1, plane0), _mm256_blendv_epi8(bright2, bright3, plane0), plane1);
+
+		if (block == 1)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), color);
+		}
+		else
+		{
+			__m256i edges = _mm256_blendv_epi8(
+				_mm256_blendv_epi8(edge0, edge1, plane0), _mm256_blendv_epi8(edge2, edge3, plane0), plane1);
+
+			if (block == 2)
+			{
+				// Interleaving works within each 128-bit half, so the halves
+				// are put back in order afterwards
+				__m256i low = _mm256_unpacklo_epi32(color, edges);
+				__m256i high = _mm256_unpackhi_epi32(color, edges);
+
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permute2x128_si256(low, high, 0x20));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8), _mm256_permute2x128_si256(low, high, 0x31));
+			}
+			else
+			{
+				alignas(32) uint32_t colorLanes[8];
+				alignas(32) uint32_t edgeLanes[8];
+
+				_mm256_store_si256(reinterpret_cast<__m256i*>(colorLanes), color);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(edgeLanes), edges);
+
+				for (unsigned int lane = 0; lane < 8; ++lane)
+				{
+					FillBlock(colorLanes[lane], edgeLanes[lane], block, out + lane * block);
+				}
+			}
+		}
+
+		out += 8 * block;
+	}
+#endif
+
+#if defined(CHIP8_SSE2)
+	const __m128i LANE_BITS4 = _mm_set_epi32(1, 2, 4, 8);
+
+	for (; column + 4 <= columns; column += 4)
+	{
+		unsigned int shift = 60u - (column & 63u);
+		unsigned int strip = column >> 6u;
+
+		__m128i bits0 = _mm_and_si128(_mm_set1_epi32(static_cast<int>((words[0][strip] >> shift) & 0xFu)), LANE_BITS4);
+		__m128i bits1 = _mm_and_si128(_mm_set1_epi32(static_cast<int>((words[1][strip] >> shift) & 0xFu)), LANE_BITS4);
+		__m128i plane0 = _mm_cmpeq_epi32(bits0, LANE_BITS4);
+		__m128i plane1 = _mm_cmpeq_epi32(bits1, LANE_BITS4);
+
+		// No blend before SSE4.1, so select with and/andnot/or
+		auto select = [](__m128i mask, __m128i set, __m128i clear)
+		{
+			return _mm_or_si128(_mm_and_si128(mask, set), _mm_andnot_si128(mask, clear));
+		};
+
+		auto pick = [&](uint32_t const* palette)
+		{
+			return select(plane1,
+				select(plane0, _mm_set1_epi32(static_cast<int>(palette[3])), _mm_set1_epi32(static_cast<int>(palette[2]))),
+				select(plane0, _mm_set1_epi32(static_cast<int>(palette[1])), _mm_set1_epi32(static_cast<int>(palette[0]))));
+		};
+
+		__m128i color = pick(bright);
+
+		if (block == 1)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out), color);
+		}
+		else
+		{
+			__m128i edges = pick(edge);
+
+			if (block == 2)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi32(color, edges));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi32(color, edges));
+			}
+			else
+			{
+				alignas(16) uint32_t colorLanes[4];
+				alignas(16) uint32_t edgeLanes[4];
+
+				_mm_store_si128(reinterpret_cast<__m128i*>(colorLanes), color);
+				_mm_store_si128(reinterpret_cast<__m128i*>(edgeLanes), edges);
+
+				for (unsigned int lane = 0; lane < 4; ++lane)
+				{
+					FillBlock(colorLanes[lane], edgeLanes[lane], block, out + lane * block);
+				}
+			}
+		}
+
+		out += 4 * block;
+	}
+#endif
+
+	for (; column < columns; ++column)
+	{
+		unsigned int shift = 63u - (column & 63u);
+		unsigned int strip = column >> 6u;
+
+		unsigned int color = ((words[0][strip] >> shift) & 1u)
+			| (((words[1][strip] >> shift) & 1u) << 1u);
+
+		FillBlock(bright[color], edge[color], block, out);
+		out += block;
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Scale the Framebuffer into Texels	//
+//											//
+//////////////////////////////////////////////
+
+VideoScaler::VideoScaler()
+{
+	SetPalette(DEFAULT_PALETTE);
+}
+
+void VideoScaler::SetScale(unsigned int scale)
+{
+	this->scale = scale < 1 ? 1 : scale > MAX_SCALE ? MAX_SCALE : scale;
+}
+
+void VideoScaler::SetPalette(uint32_t const* palette)
+{
+	// RGBA, alpha is left alone
+	for (unsigned int i = 0; i < (1u << VIDEO_PLANES); ++i)
+	{
+		uint32_t color = palette[i];
+		uint32_t dim = color & 0xFFu;
+
+		for (unsigned int channel = 8; channel < 32; channel += 8)
+		{
+			dim |= ((((color >> channel) & 0xFFu) * DIM) >> 8u) << channel;
+		}
+
+		colors[i] = color;
+		dimColors[i] = dim;
+	}
+}
+
+void VideoScaler::SetFilter(ScaleFilter filter)
+{
+	this->filter = filter;
+}
+
+void VideoScaler::Expand(VideoPlanes const& video, bool hires, unsigned int first, unsigned int end, void* pixels, int pitch) const
+{
+	unsigned int columns = hires ? VIDEO_WIDTH : LORES_WIDTH;
+	unsigned int block = hires ? scale : 2 * scale;
+
+	// A filter needs a pixel at least two texels across to leave any of it bright
+	bool filtered = filter != ScaleFilter::None && block >= 2;
+	uint32_t const* edge = filtered && filter == ScaleFilter::Grid ? dimColors : colors;
+
+	size_t rowBytes = Width() * sizeof(uint32_t);
+	uint8_t* out = static_cast<uint8_t*>(pixels);
+
+	for (unsigned int y = first; y < end && y < VIDEO_HEIGHT; ++y)
+	{
+		unsigned int row = hires ? y : y / 2;
+		uint64_t words[VIDEO_PLANES][VIDEO_STRIPS];
+
+		for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+		{
+			for (unsigned int strip = 0; strip < VIDEO_STRIPS; ++strip)
+			{
+				words[plane][strip] = video[plane][strip][row];
+			}
+		}
+
+		// A low resolution pixel spans two framebuffer rows, its bottom
+		// texels are in the second
+		bool bottom = filtered && (hires || (y & 1u) != 0);
+		unsigned int brightRows = bottom ? scale - 1 : scale;
+
+		if (brightRows > 0)
+		{
+			ExpandRow(words, columns, block, colors, edge, reinterpret_cast<uint32_t*>(out));
+
+			for (unsigned int copy = 1; copy < brightRows; ++copy)
+			{
+				std::memcpy(out + copy * pitch, out, rowBytes);
+			}
+		}
+
+		if (bottom)
+		{
+			ExpandRow(words, columns, block, dimColors, dimColors, reinterpret_cast<uint32_t*>(out + brightRows * pitch));
+		}
+
+		out += scale * pitch;
+	}
+}
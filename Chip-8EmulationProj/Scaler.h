@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstdint>
+
+// Darkened texels that make the pixels stand apart at larger scales
+enum class ScaleFilter : uint8_t
+{
+	None,
+	Scanlines,		// the bottom row of every pixel
+	Grid,			// the bottom row and right column of every pixel
+
+	Count
+};
+
+// "none", "scanlines" and "grid"
+char const* ScaleFilterName(ScaleFilter filter);
+bool ParseScaleFilter(char const* name, ScaleFilter& filter);
+
+// "default", "amber", "green", "lcd" and "cga", each RGBA by plane bits
+// like DEFAULT_PALETTE. Sets palette to one of the built in tables.
+bool ParsePalette(char const* name, uint32_t const*& palette);
+
+// Expands the packed framebuffer straight to RGBA at an integer scale, for
+// when the renderer can't be trusted to stretch a small texture quickly.
+// A high resolution pixel becomes scale x scale texels and a low
+// resolution one twice that each way. Each framebuffer row's first
+// texture row is built in SIMD lanes, the rest are copies of it.
+class VideoScaler
+{
+public:
+	VideoScaler();
+
+	void SetScale(unsigned int scale);
+	void SetPalette(uint32_t const* palette);
+	void SetFilter(ScaleFilter filter);
+
+	unsigned int Scale() const { return scale; }
+	ScaleFilter Filter() const { return filter; }
+	unsigned int Width() const { return VIDEO_WIDTH * scale; }
+	unsigned int Height() const { return VIDEO_HEIGHT * scale; }
+
+	// Write every texel of framebuffer rows first to end - 1, rows being
+	// VIDEO_HEIGHT high like the dirty rows. pixels is where row first
+	// starts and pitch the bytes from one texture row to the next, so a
+	// locked texture can be written in place.
+	void Expand(VideoPlanes const& video, bool hires, unsigned int first, unsigned int end, void* pixels, int pitch) const;
+
+private:
+	static constexpr unsigned int MAX_SCALE = 16;
+
+	// Filtered texels keep this much of each color channel, out of 256
+	static constexpr uint32_t DIM = 144;
+
+	unsigned int scale{ 1 };
+	ScaleFilter filter{ ScaleFilter::None };
+
+	uint32_t colors[1u << VIDEO_PLANES];
+	uint32_t dimColors[1u << VIDEO_PLANES];
+};
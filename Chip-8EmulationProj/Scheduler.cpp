@@ -0,0 +1,218 @@
+#include "Scheduler.h"
+#include "Audio.h"
+#include "Jit.h"
+#include "Profiler.h"
+#include "VideoFile.h"
+
+
+Scheduler::Scheduler(Chip8& chip8, Jit* jit)
+	: chip8(chip8), jit(jit)
+{
+}
+
+void Scheduler::SetInstructionsPerFrame(uint32_t count)
+{
+	instructionsPerFrame = count > 0 ? count : 1;
+
+	if (frameCycles >= instructionsPerFrame)
+	{
+		EndFrame();
+	}
+}
+
+void Scheduler::SetMode(Mode mode, double multiplier)
+{
+	this->mode = mode;
+	this->multiplier = multiplier > 0.0 ? multiplier : 1.0;
+
+	// Don't let time spent in the old mode count towards the new one
+	started = false;
+	pendingFrames = 0.0;
+}
+
+void Scheduler::SetMaxFramesPerUpdate(uint32_t frames)
+{
+	maxFramesPerUpdate = frames > 0 ? frames : 1;
+}
+
+uint32_t Scheduler::Execute(uint32_t maxCycles)
+{
+	Profiler* profiler = PROFILING_ENABLED ? chip8.GetProfiler() : nullptr;
+	Profiler::Clock::time_point start = profiler != nullptr ? Profiler::Clock::now() : Profiler::Clock::time_point();
+
+	uint32_t ran = uncached ? chip8.Interpret(maxCycles)
+		: jit != nullptr ? jit->Run(maxCycles)
+		: chip8.Run(maxCycles);
+
+	if (profiler != nullptr)
+	{
+		profiler->AddBusyTime(Profiler::Clock::now() - start);
+	}
+
+	cycles += ran;
+	frameCycles += ran;
+
+	return ran;
+}
+
+void Scheduler::EndFrame()
+{
+	// The frame sounds for as long as its sound timer was running
+	if (chip8.GetAudio() != nullptr)
+	{
+		chip8.GetAudio()->Frame(chip8);
+	}
+
+	if (chip8.GetVideoWriter() != nullptr)
+	{
+		chip8.GetVideoWriter()->Frame(chip8);
+	}
+
+	chip8.TickTimers();
+
+	if (PROFILING_ENABLED && chip8.GetProfiler() != nullptr)
+	{
+		chip8.GetProfiler()->EndFrame();
+	}
+
+	frameCycles = 0;
+	++frames;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	  Run a Number of Instructions			//
+//											//
+//////////////////////////////////////////////
+
+uint32_t Scheduler::Run(uint32_t maxCycles)
+{
+	uint32_t executed = 0;
+
+	while (executed < maxCycles)
+	{
+		uint32_t budget = instructionsPerFrame - frameCycles;
+
+		if (budget > maxCycles - executed)
+		{
+			budget = maxCycles - executed;
+		}
+
+		uint32_t ran = Execute(budget);
+		executed += ran;
+
+		// Like RunFrames, a fault ends the run without ending the frame
+		if (chip8.fault != Chip8Fault::None)
+		{
+			break;
+		}
+
+		if (frameCycles == instructionsPerFrame)
+		{
+			EndFrame();
+		}
+
+		// Parked or stuck, let the caller decide what to do. Checked on the
+		// machine, an engine can get there on the last instruction it ran.
+		if (ran < budget || chip8.WaitingForKey() || chip8.AtJumpToSelf())
+		{
+			break;
+		}
+	}
+
+	return executed;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Run a Number of Frames			//
+//											//
+//////////////////////////////////////////////
+
+uint32_t Scheduler::RunFrames(uint32_t count)
+{
+	uint32_t completed = 0;
+
+	for (; completed < count; ++completed)
+	{
+		Execute(instructionsPerFrame - frameCycles);
+
+		if (chip8.fault != Chip8Fault::None)
+		{
+			break;
+		}
+
+		// Stuck programs idle out the rest of the frame
+		EndFrame();
+	}
+
+	return completed;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Run the Frames Due by Wall Time		//
+//											//
+//////////////////////////////////////////////
+
+uint32_t Scheduler::Update()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	if (!started)
+	{
+		started = true;
+		lastUpdate = now;
+		pendingFrames = 0.0;
+	}
+
+	double elapsed = std::chrono::duration<double>(now - lastUpdate).count();
+	lastUpdate = now;
+
+	if (mode == Mode::Unthrottled)
+	{
+		return RunFrames(maxFramesPerUpdate);
+	}
+
+	double rate = FrameRate();
+	pendingFrames += elapsed * rate;
+
+	uint32_t due = static_cast<uint32_t>(pendingFrames);
+	pendingFrames -= due;
+
+	// After a long stall drop the backlog instead of fast-forwarding through it
+	if (due > maxFramesPerUpdate)
+	{
+		due = maxFramesPerUpdate;
+	}
+
+	return RunFrames(due);
+}
+
+std::chrono::steady_clock::time_point Scheduler::NextFrameDue() const
+{
+	auto now = std::chrono::steady_clock::now();
+
+	if (!started || mode == Mode::Unthrottled || pendingFrames >= 1.0)
+	{
+		return now;
+	}
+
+	auto wait = std::chrono::duration<double>((1.0 - pendingFrames) / FrameRate());
+	auto due = lastUpdate + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait);
+
+	return due > now ? due : now;
+}
+
+std::chrono::steady_clock::duration Scheduler::FramePeriod() const
+{
+	if (mode == Mode::Unthrottled)
+	{
+		return std::chrono::steady_clock::duration::zero();
+	}
+
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / FrameRate()));
+}
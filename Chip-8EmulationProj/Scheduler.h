@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Chip8.h"
+#include <chrono>
+#include <cstdint>
+
+class Jit;
+
+// Drives a Chip8 off a virtual 60 Hz clock. A frame is a fixed number of
+// instructions followed by one timer tick, so what the program sees only
+// depends on how many frames ran, never on how fast the host is. The mode
+// only decides how many frames Update runs for the wall time that passed.
+class Scheduler
+{
+public:
+	enum class Mode
+	{
+		RealTime,			// 60 frames per wall second
+		Unthrottled,		// as many frames as Update is allowed, no clock
+		FixedMultiplier		// 60 * multiplier frames per wall second
+	};
+
+	static const unsigned int TIMER_HZ = 60;
+
+	// jit may be null, blocks are then interpreted
+	explicit Scheduler(Chip8& chip8, Jit* jit = nullptr);
+
+	void SetInstructionsPerFrame(uint32_t count);
+	void SetMode(Mode mode, double multiplier = 1.0);
+
+	// Run every instruction through Chip8::Interpret instead of the block
+	// cache or the JIT, for programs that rewrite their own code
+	void SetUncached(bool enabled) { uncached = enabled; }
+
+	// Caps how far Update catches up after a stall, and how many frames it
+	// runs per call when unthrottled
+	void SetMaxFramesPerUpdate(uint32_t frames);
+
+	// Execute up to maxCycles instructions, ticking the timers at every
+	// frame boundary crossed. Returns as soon as the machine faults, waits
+	// for a key or reaches a jump to self, even on a frame's last
+	// instruction. A fault ends the run before its frame does.
+	uint32_t Run(uint32_t maxCycles);
+
+	// Run whole frames. A program that is stuck (jump to self, waiting for
+	// a key) idles out the rest of its frame but its timers keep ticking.
+	// Stops on a fault. Returns the number of frames completed.
+	uint32_t RunFrames(uint32_t frames);
+
+	// Run the frames that are due for the wall time since the last call
+	uint32_t Update();
+
+	// When Update will next have a frame to run, now if it already has
+	// one or runs unthrottled
+	std::chrono::steady_clock::time_point NextFrameDue() const;
+
+	// Wall time per frame in the current mode, 0 when unthrottled
+	std::chrono::steady_clock::duration FramePeriod() const;
+
+	uint64_t Frames() const { return frames; }
+	uint64_t Cycles() const { return cycles; }
+	uint32_t InstructionsPerFrame() const { return instructionsPerFrame; }
+
+private:
+	double FrameRate() const { return mode == Mode::FixedMultiplier ? TIMER_HZ * multiplier : TIMER_HZ; }
+
+	uint32_t Execute(uint32_t maxCycles);
+	void EndFrame();
+
+	Chip8& chip8;
+	Jit* jit;
+	bool uncached{};
+
+	Mode mode{ Mode::RealTime };
+	double multiplier{ 1.0 };
+	uint32_t instructionsPerFrame{ 10 };
+	uint32_t maxFramesPerUpdate{ 10 };
+
+	// Instructions already executed in the frame in progress
+	uint32_t frameCycles{};
+
+	uint64_t frames{};
+	uint64_t cycles{};
+
+	bool started{};
+	double pendingFrames{};
+	std::chrono::steady_clock::time_point lastUpdate;
+};
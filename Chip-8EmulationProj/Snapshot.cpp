@@ -0,0 +1,77 @@
+#include "Snapshot.h"
+#include <cstring>
+
+
+//////////////////////////////////////////////
+//											//
+//	   Copy the Machine State Out and In	//
+//											//
+//////////////////////////////////////////////
+
+void Chip8::SaveState(Chip8State& state, uint8_t* extended) const
+{
+	state = *this;
+
+	if (extended != nullptr && !extendedMemory.empty())
+	{
+		std::memcpy(extended, extendedMemory.data(), extendedMemory.size());
+	}
+}
+
+void Chip8::LoadState(Chip8State const& state, uint8_t const* extended)
+{
+	// Keep decoded blocks unless the snapshot has different code under them
+	for (unsigned int page = 0; page < 64; ++page)
+	{
+		if (((codePages >> page) & 1u) == 0)
+		{
+			continue;
+		}
+
+		unsigned int address = page << CODE_PAGE_SHIFT;
+
+		if (std::memcmp(&memory[address], &state.memory[address], 1u << CODE_PAGE_SHIFT) != 0)
+		{
+			InvalidateCode(static_cast<uint16_t>(address), 1u << CODE_PAGE_SHIFT);
+		}
+	}
+
+	static_cast<Chip8State&>(*this) = state;
+
+	// Code never runs from here, nothing cached depends on it
+	if (extended != nullptr && !extendedMemory.empty())
+	{
+		std::memcpy(extendedMemory.data(), extended, extendedMemory.size());
+	}
+
+	// The presenter has no idea what the snapshot's screen looked like
+	dirtyRows = ~0ull;
+}
+
+
+SnapshotSlots::SnapshotSlots(size_t count, size_t extendedSize)
+	: slots(new Chip8State[count]), extended(new uint8_t[count * extendedSize]), extendedSize(extendedSize), count(count)
+{
+}
+
+bool SnapshotSlots::Save(Chip8 const& chip8, size_t slot)
+{
+	if (slot >= count)
+	{
+		return false;
+	}
+
+	chip8.SaveState(slots[slot], chip8.ExtendedMemorySize() == extendedSize ? &extended[slot * extendedSize] : nullptr);
+	return true;
+}
+
+bool SnapshotSlots::Restore(Chip8& chip8, size_t slot) const
+{
+	if (slot >= count)
+	{
+		return false;
+	}
+
+	chip8.LoadState(slots[slot], chip8.ExtendedMemorySize() == extendedSize ? &extended[slot * extendedSize] : nullptr);
+	return true;
+}
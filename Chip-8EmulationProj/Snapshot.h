@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <memory>
+
+// A fixed number of save slots allocated up front. Saving and restoring
+// never allocate, each is a single Chip8State copy plus XO-CHIP's extended
+// memory when the slots were made with room for it.
+class SnapshotSlots
+{
+public:
+	// Pass the machine's ExtendedMemorySize() to keep XO-CHIP's memory
+	// past 4 KB too
+	explicit SnapshotSlots(size_t count, size_t extendedSize = 0);
+
+	size_t Count() const { return count; }
+
+	// Both return false for a slot past the end
+	bool Save(Chip8 const& chip8, size_t slot);
+	bool Restore(Chip8& chip8, size_t slot) const;
+
+	Chip8State& operator[](size_t slot) { return slots[slot]; }
+	Chip8State const& operator[](size_t slot) const { return slots[slot]; }
+
+private:
+	std::unique_ptr<Chip8State[]> slots;
+	std::unique_ptr<uint8_t[]> extended;
+	size_t extendedSize;
+	size_t count;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded queue for exactly one producer thread and one consumer thread.
+// Push and Pop never block or allocate; Push fails when the queue is full
+// and Pop when it is empty. CAPACITY must be a power of two.
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+public:
+	SpscQueue() = default;
+
+	SpscQueue(SpscQueue const&) = delete;
+	SpscQueue& operator=(SpscQueue const&) = delete;
+
+	// Producer
+	bool Push(T const& value)
+	{
+		size_t tail = this->tail.load(std::memory_order_relaxed);
+
+		if (tail - headCache == CAPACITY)
+		{
+			headCache = head.load(std::memory_order_acquire);
+
+			if (tail - headCache == CAPACITY)
+			{
+				return false;
+			}
+		}
+
+		items[tail & (CAPACITY - 1)] = value;
+		this->tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer
+	bool Pop(T& value)
+	{
+		size_t head = this->head.load(std::memory_order_relaxed);
+
+		if (head == tailCache)
+		{
+			tailCache = tail.load(std::memory_order_acquire);
+
+			if (head == tailCache)
+			{
+				return false;
+			}
+		}
+
+		value = items[head & (CAPACITY - 1)];
+		this->head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Producer, pushes as many of values as there is room for. Returns
+	// how many went in.
+	size_t Push(T const* values, size_t count)
+	{
+		size_t tail = this->tail.load(std::memory_order_relaxed);
+
+		if (CAPACITY - (tail - headCache) < count)
+		{
+			headCache = head.load(std::memory_order_acquire);
+		}
+
+		size_t room = CAPACITY - (tail - headCache);
+		count = count < room ? count : room;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			items[(tail + i) & (CAPACITY - 1)] = values[i];
+		}
+
+		this->tail.store(tail + count, std::memory_order_release);
+
+		return count;
+	}
+
+	// Consumer, pops up to count into values. Returns how many came out.
+	size_t Pop(T* values, size_t count)
+	{
+		size_t head = this->head.load(std::memory_order_relaxed);
+
+		if (tailCache - head < count)
+		{
+			tailCache = tail.load(std::memory_order_acquire);
+		}
+
+		size_t available = tailCache - head;
+		count = count < available ? count : available;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			values[i] = items[(head + i) & (CAPACITY - 1)];
+		}
+
+		this->head.store(head + count, std::memory_order_release);
+
+		return count;
+	}
+
+	// Either side, only a snapshot while the other side is running
+	size_t Size() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+private:
+	T items[CAPACITY]{};
+
+	// Each index lives on its own cache line next to the other side's
+	// last seen copy of the opposite index, so the common case touches
+	// no shared line
+	alignas(64) std::atomic<size_t> head{};
+	size_t tailCache{};
+
+	alignas(64) std::atomic<size_t> tail{};
+	size_t headCache{};
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Chip8.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Shared by the tests that check one engine against another. Every engine
+// has to leave the machine in exactly the state the interpreter does.
+
+// A ROM of random but mostly valid instructions for the profile, with
+// jumps, calls and I kept inside the program so it runs for a while,
+// rewrites its own code now and then and ends up stuck or faulting.
+inline std::vector<uint8_t> RandomRom(uint32_t seed, QuirkProfile profile, size_t size = 0x600)
+{
+	std::mt19937 rng(seed);
+	uint32_t quirks = QuirksOf(profile);
+	bool schip = (quirks & QUIRK_SCHIP) != 0;
+	bool xochip = (quirks & QUIRK_XOCHIP) != 0;
+
+	auto address = [&]() { return static_cast<uint16_t>((START_ADDRESS + rng() % size) & 0x0FFEu); };
+	auto reg = [&]() { return static_cast<uint16_t>(rng() & 0xFu); };
+
+	std::vector<uint8_t> rom(size);
+
+	for (size_t at = 0; at + 1 < size; at += 2)
+	{
+		uint16_t x = reg();
+		uint16_t y = reg();
+		uint16_t kk = static_cast<uint16_t>(rng() & 0xFFu);
+		uint16_t opcode = 0;
+
+		switch (rng() % 20)
+		{
+		case 0:
+		{
+			static const uint16_t SYSTEM[] = { 0x00E0, 0x00EE, 0x00FB, 0x00FC, 0x00FE, 0x00FF, 0x00C3, 0x00D2, 0x00FD };
+			opcode = SYSTEM[rng() % (schip ? (xochip ? 9 : 8) : 2)];
+
+			// Scroll up is XO-CHIP only
+			opcode = !xochip && opcode == 0x00D2 ? 0x00E0 : opcode;
+		}break;
+
+		case 1: opcode = 0x1000u | (rng() % 8 == 0 ? START_ADDRESS + at : address()); break;
+		case 2: opcode = 0x2000u | address(); break;
+		case 3: opcode = 0x3000u | (x << 8u) | kk; break;
+		case 4: opcode = 0x4000u | (x << 8u) | kk; break;
+		case 5: opcode = 0x5000u | (x << 8u) | (y << 4u) | (xochip ? (rng() % 3 == 0 ? 0 : 2 + rng() % 2) : 0); break;
+		case 6: opcode = 0x6000u | (x << 8u) | kk; break;
+		case 7: opcode = 0x7000u | (x << 8u) | kk; break;
+		case 8:
+		{
+			static const uint16_t ALU[] = { 0, 1, 2, 3, 4, 5, 6, 7, 0xE };
+			opcode = 0x8000u | (x << 8u) | (y << 4u) | ALU[rng() % 9];
+		}break;
+
+		case 9: opcode = 0x9000u | (x << 8u) | (y << 4u); break;
+		case 10: opcode = 0xA000u | address(); break;
+		case 11: opcode = 0xB000u | address(); break;
+		case 12: opcode = 0xC000u | (x << 8u) | kk; break;
+		case 13:
+		case 14: opcode = 0xD000u | (x << 8u) | (y << 4u) | (rng() & 0xFu); break;
+		case 15: opcode = 0xE000u | (x << 8u) | (rng() % 2 == 0 ? 0x9E : 0xA1); break;
+		default:
+		{
+			static const uint16_t MISC[] = { 0x07, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65, 0x0A, 0x30, 0x75, 0x85, 0x3A, 0x02, 0x01, 0x00 };
+			opcode = 0xF000u | (x << 8u) | MISC[rng() % (xochip ? 16 : schip ? 12 : 9)];
+		}break;
+		}
+
+		// Rarely an opcode no profile has
+		if (rng() % 64 == 0)
+		{
+			opcode = 0x800F;
+		}
+
+		rom[at] = static_cast<uint8_t>(opcode >> 8u);
+		rom[at + 1] = static_cast<uint8_t>(opcode);
+	}
+
+	return rom;
+}
+
+inline void LoadRandomRom(Chip8& chip8, uint32_t seed, QuirkProfile profile)
+{
+	std::vector<uint8_t> rom = RandomRom(seed, profile);
+
+	chip8.SetQuirkProfile(profile);
+	chip8.LoadROM(rom.data(), rom.size());
+}
+
+// Every field of the machine state, named where they differ
+inline ::testing::AssertionResult SameState(Chip8 const& a, Chip8 const& b)
+{
+	::testing::AssertionResult result = ::testing::AssertionSuccess();
+	bool same = true;
+
+	auto check = [&](bool equal, char const* name)
+	{
+		if (!equal)
+		{
+			result = (same ? ::testing::AssertionFailure() : result) << name << " ";
+			same = false;
+		}
+	};
+
+	check(std::memcmp(a.registers, b.registers, sizeof(a.registers)) == 0, "registers");
+	check(std::memcmp(a.memory, b.memory, sizeof(a.memory)) == 0, "memory");
+	check(a.ExtendedMemorySize() == b.ExtendedMemorySize()
+		&& std::memcmp(a.ExtendedMemory(), b.ExtendedMemory(), a.ExtendedMemorySize()) == 0, "extended memory");
+	check(a.index == b.index, "index");
+	check(a.pc == b.pc, "pc");
+	check(std::memcmp(a.stack, b.stack, sizeof(a.stack)) == 0, "stack");
+	check(a.sp == b.sp, "sp");
+	check(a.delayTimer == b.delayTimer, "delay timer");
+	check(a.soundTimer == b.soundTimer, "sound timer");
+	check(a.keypad == b.keypad, "keypad");
+	check(a.fault == b.fault, "fault");
+	check(a.waitingForKey == b.waitingForKey && a.waitRegister == b.waitRegister, "key wait");
+	check(std::memcmp(a.video, b.video, sizeof(a.video)) == 0, "video");
+	check(a.hires == b.hires, "hires");
+	check(a.planeMask == b.planeMask, "plane mask");
+	check(std::memcmp(a.flags, b.flags, sizeof(a.flags)) == 0, "flags");
+	check(std::memcmp(a.audioPattern, b.audioPattern, sizeof(a.audioPattern)) == 0 && a.pitch == b.pitch, "audio");
+	check(a.randState == b.randState && a.randBits == b.randBits && a.randBytesLeft == b.randBytesLeft, "random state");
+
+	return result;
+}
+
+// Every profile, for tests that loop over them
+static const QuirkProfile ALL_PROFILES[] =
+{
+	QuirkProfile::Default,
+	QuirkProfile::CosmacVip,
+	QuirkProfile::SuperChip,
+	QuirkProfile::XoChip
+};
@@ -0,0 +1,178 @@
+#include "ThreadPool.h"
+
+
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0)
+	{
+		threads = std::thread::hardware_concurrency();
+	}
+
+	threadCount = threads > 0 ? threads : 1;
+	ranges.reset(new Range[threadCount]);
+
+	// Worker 0 is whoever calls ParallelFor
+	for (unsigned int worker = 1; worker < threadCount; ++worker)
+	{
+		this->threads.emplace_back(&ThreadPool::WorkerMain, this, worker);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//	   Split, Run and Wait for a Job		//
+//											//
+//////////////////////////////////////////////
+
+void ThreadPool::ParallelFor(size_t count, std::function<void(size_t, unsigned int)> const& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	uint32_t total = static_cast<uint32_t>(count);
+
+	for (unsigned int worker = 0; worker < threadCount; ++worker)
+	{
+		uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(total) * worker / threadCount);
+		uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(total) * (worker + 1) / threadCount);
+
+		ranges[worker].bounds.store(Pack(begin, end), std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = &task;
+		busy = threadCount - 1;
+		++generation;
+	}
+
+	wake.notify_all();
+
+	Work(0);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busy == 0; });
+	this->task = nullptr;
+}
+
+void ThreadPool::WorkerMain(unsigned int worker)
+{
+	uint64_t seen = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+
+			if (stopping)
+			{
+				return;
+			}
+
+			seen = generation;
+		}
+
+		Work(worker);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if (--busy == 0)
+		{
+			done.notify_one();
+		}
+	}
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		  Pop Own Work, Steal the Rest		//
+//											//
+//////////////////////////////////////////////
+
+void ThreadPool::Work(unsigned int worker)
+{
+	do
+	{
+		uint32_t index;
+
+		while (Pop(worker, index))
+		{
+			(*task)(index, worker);
+		}
+	} while (Steal(worker));
+}
+
+bool ThreadPool::Pop(unsigned int worker, uint32_t& index)
+{
+	std::atomic<uint64_t>& bounds = ranges[worker].bounds;
+	uint64_t current = bounds.load(std::memory_order_acquire);
+
+	while (Begin(current) < End(current))
+	{
+		if (bounds.compare_exchange_weak(current, Pack(Begin(current) + 1, End(current)), std::memory_order_acq_rel))
+		{
+			index = Begin(current);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ThreadPool::Steal(unsigned int worker)
+{
+	for (;;)
+	{
+		unsigned int victim = worker;
+		uint64_t victimBounds = 0;
+		uint32_t most = 0;
+
+		for (unsigned int other = 0; other < threadCount; ++other)
+		{
+			uint64_t bounds = ranges[other].bounds.load(std::memory_order_acquire);
+			uint32_t left = End(bounds) > Begin(bounds) ? End(bounds) - Begin(bounds) : 0;
+
+			if (other != worker && left > most)
+			{
+				victim = other;
+				victimBounds = bounds;
+				most = left;
+			}
+		}
+
+		// Anything still out there is already being run by its owner
+		if (most == 0)
+		{
+			return false;
+		}
+
+		// Take the back half, the owner keeps popping from the front
+		uint32_t middle = Begin(victimBounds) + most / 2;
+
+		if (ranges[victim].bounds.compare_exchange_strong(victimBounds, Pack(Begin(victimBounds), middle), std::memory_order_acq_rel))
+		{
+			ranges[worker].bounds.store(Pack(middle, End(victimBounds)), std::memory_order_release);
+			return true;
+		}
+	}
+}
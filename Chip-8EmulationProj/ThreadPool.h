@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads for running many independent jobs. Each
+// ParallelFor splits the index range evenly between the workers up front;
+// a worker that runs out takes the back half of whichever range has the
+// most left, so ROMs that halt early don't leave threads idle.
+class ThreadPool
+{
+public:
+	// threads counts the calling thread, 0 means one per hardware thread
+	explicit ThreadPool(unsigned int threads = 0);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	unsigned int Threads() const { return threadCount; }
+
+	// Calls task(index, worker) for every index below count and returns
+	// once all of them are done. worker is below Threads() and no two
+	// calls with the same worker run at once, so it can pick per-thread
+	// scratch state. The calling thread works too.
+	void ParallelFor(size_t count, std::function<void(size_t, unsigned int)> const& task);
+
+private:
+	// [begin, end) packed in one word so popping and stealing are one CAS
+	struct alignas(64) Range
+	{
+		std::atomic<uint64_t> bounds{};
+	};
+
+	static uint64_t Pack(uint32_t begin, uint32_t end) { return (static_cast<uint64_t>(end) << 32u) | begin; }
+	static uint32_t Begin(uint64_t bounds) { return static_cast<uint32_t>(bounds); }
+	static uint32_t End(uint64_t bounds) { return static_cast<uint32_t>(bounds >> 32u); }
+
+	bool Pop(unsigned int worker, uint32_t& index);
+	bool Steal(unsigned int worker);
+	void Work(unsigned int worker);
+	void WorkerMain(unsigned int worker);
+
+	unsigned int threadCount;
+	std::unique_ptr<Range[]> ranges;
+	std::vector<std::thread> threads;
+
+	std::function<void(size_t, unsigned int)> const* task{};
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation{};
+	unsigned int busy{};
+	bool stopping{};
+};
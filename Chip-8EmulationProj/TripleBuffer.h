@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the newest value from one writer thread to one reader thread
+// without either ever waiting. The writer fills Back and publishes it;
+// the reader takes whatever was published last, anything older that it
+// never got to is overwritten. Neither side touches the slot the other
+// one is using.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	TripleBuffer(TripleBuffer const&) = delete;
+	TripleBuffer& operator=(TripleBuffer const&) = delete;
+
+	// Writer: the slot to fill next
+	T& Back() { return slots[back]; }
+
+	// Writer: make Back the newest value and start on a free slot
+	void Publish()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	// Reader: move to the newest value if one was published since the
+	// last call. Returns false if Front is still the newest.
+	bool Acquire()
+	{
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+		{
+			return false;
+		}
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+	// Reader: the value taken by the last successful Acquire
+	T const& Front() const { return slots[front]; }
+
+private:
+	static constexpr uint8_t INDEX = 0x3;
+	static constexpr uint8_t FRESH = 0x4;
+
+	T slots[3]{};
+
+	// Slot index shared between the two sides, FRESH while the reader
+	// hasn't taken it
+	alignas(64) std::atomic<uint8_t> middle{ 1 };
+
+	// Owned by the writer and the reader respectively
+	alignas(64) uint8_t back{ 0 };
+	alignas(64) uint8_t front{ 2 };
+};
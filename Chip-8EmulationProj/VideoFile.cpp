@@ -0,0 +1,691 @@
+#include "VideoFile.h"
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#define CHIP8_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CHIP8_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+static const uint8_t VIDEO_MAGIC[4] = { 'C', '8', 'V', 'D' };
+static const uint8_t VIDEO_VERSION = 1;
+
+// Words and bytes in one row of every plane and strip
+static const unsigned int ROW_WORDS = VIDEO_PLANES * VIDEO_STRIPS;
+static const unsigned int ROW_BYTES = ROW_WORDS * 8;
+
+
+//////////////////////////////////////////////
+//											//
+//		   Record What Each Frame Changed	//
+//											//
+//////////////////////////////////////////////
+
+// Bit n set where row n differs in any plane or strip, several rows at a
+// time in vector lanes
+static uint64_t ChangedRows(VideoPlanes const& video, VideoPlanes const& previous)
+{
+	uint64_t rows = 0;
+	unsigned int y = 0;
+
+#if defined(CHIP8_AVX2)
+	for (; y + 4 <= VIDEO_HEIGHT; y += 4)
+	{
+		__m256i changed = _mm256_setzero_si256();
+
+		for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+		{
+			for (unsigned int strip = 0; strip < VIDEO_STRIPS; ++strip)
+			{
+				__m256i now = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&video[plane][strip][y]));
+				__m256i before = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&previous[plane][strip][y]));
+
+				changed = _mm256_or_si256(changed, _mm256_xor_si256(now, before));
+			}
+		}
+
+		unsigned int same = static_cast<unsigned int>(
+			_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(changed, _mm256_setzero_si256()))));
+
+		rows |= uint64_t(~same & 0xFu) << y;
+	}
+#endif
+
+#if defined(CHIP8_SSE2)
+	for (; y + 2 <= VIDEO_HEIGHT; y += 2)
+	{
+		__m128i changed = _mm_setzero_si128();
+
+		for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+		{
+			for (unsigned int strip = 0; strip < VIDEO_STRIPS; ++strip)
+			{
+				__m128i now = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&video[plane][strip][y]));
+				__m128i before = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&previous[plane][strip][y]));
+
+				changed = _mm_or_si128(changed, _mm_xor_si128(now, before));
+			}
+		}
+
+		// No 64-bit compare before SSE4.1, a row is the same when both its
+		// halves are, and then the sign of its high half stands for it
+		__m128i same = _mm_cmpeq_epi32(changed, _mm_setzero_si128());
+		same = _mm_and_si128(same, _mm_shuffle_epi32(same, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		unsigned int bits = static_cast<unsigned int>(_mm_movemask_pd(_mm_castsi128_pd(same)));
+
+		rows |= uint64_t(~bits & 0x3u) << y;
+	}
+#endif
+
+	for (; y < VIDEO_HEIGHT; ++y)
+	{
+		uint64_t changed = 0;
+
+		for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+		{
+			for (unsigned int strip = 0; strip < VIDEO_STRIPS; ++strip)
+			{
+				changed |= video[plane][strip][y] ^ previous[plane][strip][y];
+			}
+		}
+
+		rows |= (changed != 0 ? 1ull : 0ull) << y;
+	}
+
+	return rows;
+}
+
+// Index of the lowest set bit, bits must not be 0
+static inline unsigned int LowestBit(uint64_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long bit;
+	_BitScanForward64(&bit, bits);
+	return static_cast<unsigned int>(bit);
+#else
+	return static_cast<unsigned int>(__builtin_ctzll(bits));
+#endif
+}
+
+// The same for only the rows in candidates, the rest are known not to differ
+static uint64_t ChangedRows(VideoPlanes const& video, VideoPlanes const& previous, uint64_t candidates)
+{
+	uint64_t rows = 0;
+
+	for (uint64_t pending = candidates; pending != 0; pending &= pending - 1)
+	{
+		unsigned int y = LowestBit(pending);
+		uint64_t changed = 0;
+
+		for (unsigned int plane = 0; plane < VIDEO_PLANES; ++plane)
+		{
+			for (unsigned int strip = 0; strip < VIDEO_STRIPS; ++strip)
+			{
+				changed |= video[plane][strip][y] ^ previous[plane][strip][y];
+			}
+		}
+
+		rows |= (changed != 0 ? 1ull : 0ull) << y;
+	}
+
+	return rows;
+}
+
+// Bit i set where byte i of word, most significant first, is not zero.
+// The top bit of each byte is set if any of its bits are, then the eight
+// top bits are gathered into the high byte by one multiply.
+static inline uint32_t ChangedBytes(uint64_t word)
+{
+	const uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7Full;
+
+	uint64_t nonzero = (((word & LOW_BITS) + LOW_BITS) | word) & ~LOW_BITS;
+
+	return static_cast<uint32_t>(((nonzero >> 7u) * 0x8040201008040201ull) >> 56u);
+}
+
+VideoWriter::~VideoWriter()
+{
+	if (file != nullptr)
+	{
+		Finish();
+	}
+}
+
+bool VideoWriter::Open(char const* filename)
+{
+	file = std::fopen(filename, "wb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	failed = false;
+	bytes = 0;
+	buffered = 0;
+	frames = lastRecord = 0;
+	std::memset(previous, 0, sizeof(previous));
+	previousHires = false;
+	compareAll = true;
+
+	for (uint8_t byte : VIDEO_MAGIC)
+	{
+		Put(byte);
+	}
+
+	Put(VIDEO_VERSION);
+	Put(static_cast<uint8_t>(VIDEO_WIDTH));
+	Put(static_cast<uint8_t>(VIDEO_WIDTH >> 8u));
+	Put(static_cast<uint8_t>(VIDEO_HEIGHT));
+	Put(static_cast<uint8_t>(VIDEO_HEIGHT >> 8u));
+	Put(static_cast<uint8_t>(VIDEO_PLANES));
+
+	return true;
+}
+
+void VideoWriter::Frame(VideoPlanes const& video, bool hires, uint64_t dirtyRows)
+{
+	if (file == nullptr)
+	{
+		return;
+	}
+
+	uint64_t frame = frames++;
+
+	// Dirty rows count in the current resolution, they say nothing about
+	// the rows a switch left behind
+	if (compareAll || hires != previousHires)
+	{
+		dirtyRows = ~0ull;
+		compareAll = false;
+	}
+
+	// Most frames draw nothing and cost only this
+	if (dirtyRows == 0)
+	{
+		return;
+	}
+
+	// A few drawn rows are checked one by one, a whole screen's worth
+	// all at once. Either way drawing can leave a row as it was.
+	uint64_t rows = 0;
+
+	if (dirtyRows != ~0ull)
+	{
+		rows = ChangedRows(video, previous, dirtyRows);
+	}
+	else if (std::memcmp(video, previous, sizeof(previous)) != 0)
+	{
+		rows = ChangedRows(video, previous);
+	}
+
+	if (rows == 0 && hires == previousHires)
+	{
+		return;
+	}
+
+	// Appended straight to the buffer, so there must be room for the
+	// longest record, every byte of every row changing
+	if (BUFFER_SIZE - buffered < MAX_RECORD)
+	{
+		Flush();
+	}
+
+	uint8_t* begin = buffer + buffered;
+	uint8_t* out = begin;
+
+	out = PutVarint(out, ((frame - lastRecord) << 2) | (hires ? 2u : 0u));
+	out = PutVarint(out, rows);
+
+	for (uint64_t pending = rows; pending != 0; pending &= pending - 1)
+	{
+		unsigned int y = LowestBit(pending);
+
+		// Each word of the row is compared once and its changed bytes
+		// found all at once, then only those bytes are visited
+		uint64_t changed[ROW_WORDS];
+		uint32_t mask = 0;
+
+		for (unsigned int word = 0; word < ROW_WORDS; ++word)
+		{
+			unsigned int plane = word / VIDEO_STRIPS;
+			unsigned int strip = word % VIDEO_STRIPS;
+
+			changed[word] = video[plane][strip][y] ^ previous[plane][strip][y];
+
+			// Low resolution and a single plane leave most words alone
+			if (changed[word] != 0)
+			{
+				mask |= ChangedBytes(changed[word]) << (word * 8);
+				previous[plane][strip][y] = video[plane][strip][y];
+			}
+		}
+
+		out = PutVarint(out, mask);
+
+		for (uint32_t left = mask; left != 0; left &= left - 1)
+		{
+			unsigned int at = LowestBit(left);
+
+			*out++ = static_cast<uint8_t>(changed[at / 8] >> (56u - (at % 8) * 8u));
+		}
+	}
+
+	size_t size = static_cast<size_t>(out - begin);
+
+	buffered += size;
+	bytes += size;
+
+	previousHires = hires;
+	lastRecord = frame;
+}
+
+bool VideoWriter::Finish()
+{
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	PutVarint(((frames - lastRecord) << 2) | 1u);
+	Flush();
+
+	failed |= std::fclose(file) != 0;
+	file = nullptr;
+
+	return !failed;
+}
+
+uint8_t* VideoWriter::PutVarint(uint8_t* out, uint64_t value)
+{
+	while (value >= 0x80u)
+	{
+		*out++ = static_cast<uint8_t>(value | 0x80u);
+		value >>= 7u;
+	}
+
+	*out++ = static_cast<uint8_t>(value);
+
+	return out;
+}
+
+void VideoWriter::Put(uint8_t byte)
+{
+	if (buffered == BUFFER_SIZE)
+	{
+		Flush();
+	}
+
+	buffer[buffered++] = byte;
+	++bytes;
+}
+
+void VideoWriter::PutVarint(uint64_t value)
+{
+	while (value >= 0x80u)
+	{
+		Put(static_cast<uint8_t>(value | 0x80u));
+		value >>= 7u;
+	}
+
+	Put(static_cast<uint8_t>(value));
+}
+
+void VideoWriter::Flush()
+{
+	if (buffered > 0 && std::fwrite(buffer, 1, buffered, file) != buffered)
+	{
+		failed = true;
+	}
+
+	buffered = 0;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Stream the Frames Back In		//
+//											//
+//////////////////////////////////////////////
+
+VideoReader::~VideoReader()
+{
+	if (file != nullptr)
+	{
+		std::fclose(file);
+	}
+}
+
+bool VideoReader::Open(char const* filename)
+{
+	file = std::fopen(filename, "rb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	uint8_t header[10];
+
+	for (uint8_t& byte : header)
+	{
+		if (!Get(byte))
+		{
+			return false;
+		}
+	}
+
+	// Only files of this build's framebuffer can be played into it
+	if (std::memcmp(header, VIDEO_MAGIC, sizeof(VIDEO_MAGIC)) != 0 || header[4] == 0 || header[4] > VIDEO_VERSION
+		|| (header[5] | (header[6] << 8u)) != VIDEO_WIDTH || (header[7] | (header[8] << 8u)) != VIDEO_HEIGHT
+		|| header[9] != VIDEO_PLANES)
+	{
+		return false;
+	}
+
+	std::memset(video, 0, sizeof(video));
+	hires = false;
+	frame = 0;
+	started = false;
+	changes = 0;
+	nextFrame = 0;
+	truncated = false;
+
+	if (!ReadRecord())
+	{
+		Stop(0);
+	}
+
+	return true;
+}
+
+bool VideoReader::Next()
+{
+	uint64_t wanted = started ? frame + 1 : 0;
+
+	while (!nextIsEnd && nextFrame <= wanted)
+	{
+		if (!ApplyRecord())
+		{
+			Stop(wanted);
+			return false;
+		}
+
+		if (!ReadRecord())
+		{
+			Stop(wanted + 1);
+		}
+	}
+
+	if (nextIsEnd && wanted >= nextFrame)
+	{
+		return false;
+	}
+
+	frame = wanted;
+	started = true;
+
+	return true;
+}
+
+bool VideoReader::ReadRecord()
+{
+	uint64_t value;
+
+	if (!GetVarint(value))
+	{
+		return false;
+	}
+
+	nextFrame += value >> 2;
+	nextHires = (value & 2u) != 0;
+	nextIsEnd = (value & 1u) != 0;
+
+	return true;
+}
+
+bool VideoReader::ApplyRecord()
+{
+	uint64_t rows;
+
+	if (!GetVarint(rows))
+	{
+		return false;
+	}
+
+	for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y)
+	{
+		uint64_t mask;
+
+		if (((rows >> y) & 1u) == 0)
+		{
+			continue;
+		}
+
+		if (!GetVarint(mask))
+		{
+			return false;
+		}
+
+		for (unsigned int i = 0; i < ROW_BYTES; ++i)
+		{
+			uint8_t byte;
+
+			if (((mask >> i) & 1u) == 0)
+			{
+				continue;
+			}
+
+			if (!Get(byte))
+			{
+				return false;
+			}
+
+			unsigned int plane = i / (VIDEO_STRIPS * 8);
+			unsigned int strip = (i / 8) % VIDEO_STRIPS;
+
+			video[plane][strip][y] ^= uint64_t(byte) << (56u - (i % 8) * 8u);
+		}
+	}
+
+	hires = nextHires;
+	++changes;
+
+	return true;
+}
+
+void VideoReader::Stop(uint64_t end)
+{
+	// Play what made it to disk and stop there
+	truncated = true;
+	nextIsEnd = true;
+	nextFrame = end;
+}
+
+bool VideoReader::Get(uint8_t& byte)
+{
+	if (position == buffered)
+	{
+		buffered = std::fread(buffer, 1, BUFFER_SIZE, file);
+		position = 0;
+
+		if (buffered == 0)
+		{
+			return false;
+		}
+	}
+
+	byte = buffer[position++];
+	return true;
+}
+
+bool VideoReader::GetVarint(uint64_t& value)
+{
+	value = 0;
+
+	for (unsigned int shift = 0; shift < 64; shift += 7)
+	{
+		uint8_t byte;
+
+		if (!Get(byte))
+		{
+			return false;
+		}
+
+		value |= uint64_t(byte & 0x7Fu) << shift;
+
+		if ((byte & 0x80u) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+//////////////////////////////////////////////
+//											//
+//		   Export a Frame as a PNG			//
+//											//
+//////////////////////////////////////////////
+
+static uint32_t Crc32(uint8_t const* data, size_t size, uint32_t crc)
+{
+	crc = ~crc;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+
+		for (unsigned int bit = 0; bit < 8; ++bit)
+		{
+			crc = (crc >> 1u) ^ (0xEDB88320u & (0u - (crc & 1u)));
+		}
+	}
+
+	return ~crc;
+}
+
+static void PutBig32(std::vector<uint8_t>& out, uint32_t value)
+{
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		out.push_back(static_cast<uint8_t>(value >> (24u - i * 8u)));
+	}
+}
+
+static void PutChunk(std::vector<uint8_t>& out, char const* type, std::vector<uint8_t> const& data)
+{
+	PutBig32(out, static_cast<uint32_t>(data.size()));
+
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+
+	PutBig32(out, Crc32(&out[start], out.size() - start, 0));
+}
+
+bool WritePng(char const* filename, VideoPlanes const& video, bool hires, uint32_t const* palette)
+{
+	unsigned int width = hires ? VIDEO_WIDTH : LORES_WIDTH;
+	unsigned int height = hires ? VIDEO_HEIGHT : LORES_HEIGHT;
+
+	// 2 bits a pixel, leftmost in the high bits, each row after a filter
+	// byte of 0 for none
+	std::vector<uint8_t> image;
+
+	for (unsigned int y = 0; y < height; ++y)
+	{
+		image.push_back(0);
+
+		for (unsigned int x = 0; x < width; x += 4)
+		{
+			uint8_t packed = 0;
+
+			for (unsigned int i = 0; i < 4; ++i)
+			{
+				unsigned int shift = 63u - ((x + i) & 63u);
+				unsigned int strip = (x + i) >> 6u;
+
+				unsigned int color = ((video[0][strip][y] >> shift) & 1u)
+					| (((video[1][strip][y] >> shift) & 1u) << 1u);
+
+				packed |= static_cast<uint8_t>(color << (6u - i * 2u));
+			}
+
+			image.push_back(packed);
+		}
+	}
+
+	// zlib around stored deflate blocks, a frame is too small for
+	// compression to be worth a dependency
+	std::vector<uint8_t> compressed = { 0x78, 0x01 };
+	uint32_t adlerLow = 1, adlerHigh = 0;
+
+	for (size_t start = 0; start < image.size(); start += 0xFFFF)
+	{
+		size_t length = image.size() - start < 0xFFFF ? image.size() - start : 0xFFFF;
+
+		compressed.push_back(start + length == image.size() ? 1 : 0);
+		compressed.push_back(static_cast<uint8_t>(length));
+		compressed.push_back(static_cast<uint8_t>(length >> 8u));
+		compressed.push_back(static_cast<uint8_t>(~length));
+		compressed.push_back(static_cast<uint8_t>(~length >> 8u));
+		compressed.insert(compressed.end(), image.begin() + start, image.begin() + start + length);
+	}
+
+	for (uint8_t byte : image)
+	{
+		adlerLow = (adlerLow + byte) % 65521u;
+		adlerHigh = (adlerHigh + adlerLow) % 65521u;
+	}
+
+	PutBig32(compressed, (adlerHigh << 16u) | adlerLow);
+
+	std::vector<uint8_t> header;
+	PutBig32(header, width);
+	PutBig32(header, height);
+	header.push_back(2);	// bit depth
+	header.push_back(3);	// indexed color
+	header.push_back(0);	// deflate
+	header.push_back(0);	// adaptive filtering
+	header.push_back(0);	// not interlaced
+
+	std::vector<uint8_t> colors;
+
+	for (unsigned int i = 0; i < (1u << VIDEO_PLANES); ++i)
+	{
+		colors.push_back(static_cast<uint8_t>(palette[i] >> 24u));
+		colors.push_back(static_cast<uint8_t>(palette[i] >> 16u));
+		colors.push_back(static_cast<uint8_t>(palette[i] >> 8u));
+	}
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	PutChunk(png, "IHDR", header);
+	PutChunk(png, "PLTE", colors);
+	PutChunk(png, "IDAT", compressed);
+	PutChunk(png, "IEND", std::vector<uint8_t>());
+
+	std::FILE* file = std::fopen(filename, "wb");
+
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	bool written = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+
+	return std::fclose(file) == 0 && written;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Chip8.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Video files hold every frame of a run for archiving and comparing runs.
+// A frame the same as the one before costs nothing, any other is stored as
+// what changed, so an hour of mostly still 60 Hz frames is megabytes.
+//
+// Layout, all integers little-endian:
+//   "C8VD", version byte, uint16 width, uint16 height, plane count byte
+//   then records of varint (frames since the last record << 2 | hires << 1
+//   | end). Unless end is set the record is a frame that differs from the
+//   one before: a varint mask of the rows that changed (bit n is row n),
+//   and for each of them from the top a varint mask of which of the row's
+//   bytes changed, then those bytes XORed with what was there. A row's
+//   bytes are plane 0 then 1, strip 0 then 1, most significant first.
+//   Frames up to the next record repeat the last one, the end record's
+//   frame is the length of the video. Before the first record the frame
+//   is blank and low resolution.
+class VideoWriter
+{
+public:
+	VideoWriter() = default;
+	~VideoWriter();
+
+	VideoWriter(VideoWriter const&) = delete;
+	VideoWriter& operator=(VideoWriter const&) = delete;
+
+	bool Open(char const* filename);
+	bool IsOpen() const { return file != nullptr; }
+
+	// Append the frame that is ending. Given a machine only the rows it
+	// drew to since the last frame are compared, otherwise every row is.
+	void Frame(Chip8& chip8) { Frame(chip8.video, chip8.hires, chip8.TakeDirtyRowsToRecord()); }
+	void Frame(VideoPlanes const& video, bool hires) { Frame(video, hires, ~0ull); }
+
+	// Rows outside dirtyRows must be the same as in the frame before
+	void Frame(VideoPlanes const& video, bool hires, uint64_t dirtyRows);
+
+	// Write the end record and close. Returns false if any write failed.
+	bool Finish();
+
+	uint64_t Frames() const { return frames; }
+	uint64_t Bytes() const { return bytes; }
+
+private:
+	static constexpr size_t BUFFER_SIZE = 64 * 1024;
+	static constexpr size_t MAX_VARINT = 10;
+
+	// A frame record with every byte of every row changed
+	static constexpr size_t MAX_RECORD = 2 * MAX_VARINT + VIDEO_HEIGHT * (MAX_VARINT + VIDEO_PLANES * VIDEO_STRIPS * 8);
+
+	// Append value at out, returning where it ends
+	static uint8_t* PutVarint(uint8_t* out, uint64_t value);
+
+	void Put(uint8_t byte);
+	void PutVarint(uint64_t value);
+	void Flush();
+
+	std::FILE* file{};
+	bool failed{};
+	uint64_t bytes{};
+
+	uint8_t buffer[BUFFER_SIZE];
+	size_t buffered{};
+
+	uint64_t frames{};
+	uint64_t lastRecord{};
+
+	VideoPlanes previous{};
+	bool previousHires{};
+
+	// The first frame after Open can't trust what the machine says it drew
+	bool compareAll{};
+};
+
+class VideoReader
+{
+public:
+	VideoReader() = default;
+	~VideoReader();
+
+	VideoReader(VideoReader const&) = delete;
+	VideoReader& operator=(VideoReader const&) = delete;
+
+	// Reads the header only, frames are streamed as they are asked for
+	bool Open(char const* filename);
+
+	// Step to the next frame, the first call to frame 0. Returns false
+	// once the video is over.
+	bool Next();
+
+	// The frame stepped to and its number
+	VideoPlanes const& Video() const { return video; }
+	bool Hires() const { return hires; }
+	uint64_t Frame() const { return frame; }
+
+	// Records read so far, which is the frames that changed
+	uint64_t Changes() const { return changes; }
+
+	// True if the file ended in the middle of a record or without an end
+	bool Truncated() const { return truncated; }
+
+private:
+	static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+	bool Get(uint8_t& byte);
+	bool GetVarint(uint64_t& value);
+	bool ReadRecord();
+	bool ApplyRecord();
+
+	// Give up on the rest of the file, the video ending before frame end
+	void Stop(uint64_t end);
+
+	std::FILE* file{};
+
+	uint8_t buffer[BUFFER_SIZE];
+	size_t buffered{};
+	size_t position{};
+
+	VideoPlanes video{};
+	bool hires{};
+	uint64_t frame{};
+	bool started{};
+	uint64_t changes{};
+
+	// The next record's frame, whose changes are still to be read
+	uint64_t nextFrame{};
+	bool nextHires{};
+	bool nextIsEnd{};
+	bool truncated{};
+};
+
+// Write one frame as an indexed PNG at its own resolution, 128x64 or 64x32,
+// with the palette's colors and no compression. Alpha is ignored.
+bool WritePng(char const* filename, VideoPlanes const& video, bool hires, uint32_t const* palette = DEFAULT_PALETTE);
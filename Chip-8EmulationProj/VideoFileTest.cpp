@@ -0,0 +1,141 @@
+#include "Scheduler.h"
+#include "TestSupport.h"
+#include "VideoFile.h"
+#include <cstdio>
+#include <string>
+
+
+//////////////////////////////////////////////
+//											//
+//		   Recorded Frames Read Back		//
+//											//
+//////////////////////////////////////////////
+
+struct RecordedFrame
+{
+	VideoPlanes video;
+	bool hires;
+};
+
+static std::string VideoPath(char const* name)
+{
+	return ::testing::TempDir() + name;
+}
+
+// Every frame the reader steps through is the one that was recorded
+static void ExpectReadsBack(std::string const& filename, std::vector<RecordedFrame> const& frames)
+{
+	VideoReader reader;
+	ASSERT_TRUE(reader.Open(filename.c_str()));
+
+	for (size_t at = 0; at < frames.size(); ++at)
+	{
+		SCOPED_TRACE(::testing::Message() << "frame " << at);
+		ASSERT_TRUE(reader.Next());
+		EXPECT_EQ(reader.Frame(), at);
+		EXPECT_EQ(reader.Hires(), frames[at].hires);
+		EXPECT_EQ(std::memcmp(reader.Video(), frames[at].video, sizeof(VideoPlanes)), 0);
+	}
+
+	EXPECT_FALSE(reader.Next());
+	EXPECT_FALSE(reader.Truncated());
+}
+
+// Frames written whole, with still runs, single rows, both planes and
+// switches between resolutions
+TEST(VideoFile, WholeFramesReadBack)
+{
+	std::string filename = VideoPath("chip8-whole.c8vd");
+	std::mt19937_64 rng(3);
+	std::vector<RecordedFrame> frames;
+	RecordedFrame frame{};
+
+	VideoWriter writer;
+	ASSERT_TRUE(writer.Open(filename.c_str()));
+
+	for (unsigned int at = 0; at < 500; ++at)
+	{
+		switch (rng() % 6)
+		{
+		case 0: break;
+		case 1: frame.hires = !frame.hires; break;
+		case 2: std::memset(frame.video, 0, sizeof(frame.video)); break;
+
+		default:
+		{
+			for (unsigned int count = rng() % 8; count-- != 0;)
+			{
+				frame.video[rng() % VIDEO_PLANES][rng() % VIDEO_STRIPS][rng() % VIDEO_HEIGHT] ^= rng();
+			}
+		}break;
+		}
+
+		writer.Frame(frame.video, frame.hires);
+		frames.push_back(frame);
+	}
+
+	ASSERT_TRUE(writer.Finish());
+	ExpectReadsBack(filename, frames);
+	std::remove(filename.c_str());
+}
+
+// Random programs recorded by the scheduler, which hands the writer only
+// the rows drawn to, while the presenter takes its own rows partway
+// through some frames
+TEST(VideoFile, ScheduledRunsReadBack)
+{
+	std::string filename = VideoPath("chip8-scheduled.c8vd");
+	std::mt19937 rng(4);
+
+	for (QuirkProfile profile : ALL_PROFILES)
+	{
+		for (uint32_t seed = 0; seed < 40; ++seed)
+		{
+			Chip8 chip8{ seed };
+			LoadRandomRom(chip8, seed, profile);
+			chip8.keypad = static_cast<uint16_t>(seed * 0x9E37u);
+
+			VideoWriter writer;
+			ASSERT_TRUE(writer.Open(filename.c_str()));
+			chip8.SetVideoWriter(&writer);
+
+			Scheduler scheduler(chip8);
+			scheduler.SetMode(Scheduler::Mode::Unthrottled);
+			uint32_t perFrame = scheduler.InstructionsPerFrame();
+			std::vector<RecordedFrame> frames;
+
+			// A stop or fault leaves the frame unfinished and not recorded
+			while (frames.size() < 300)
+			{
+				uint32_t first = 1 + rng() % (perFrame - 1);
+
+				if (scheduler.Run(first) < first)
+				{
+					break;
+				}
+
+				if (rng() % 2 == 0)
+				{
+					chip8.TakeDirtyRows();
+				}
+
+				if (scheduler.Run(perFrame - first) < perFrame - first || scheduler.Frames() == frames.size())
+				{
+					break;
+				}
+
+				frames.push_back(RecordedFrame{});
+				std::memcpy(frames.back().video, chip8.video, sizeof(VideoPlanes));
+				frames.back().hires = chip8.hires;
+			}
+
+			chip8.SetVideoWriter(nullptr);
+			ASSERT_TRUE(writer.Finish());
+
+			SCOPED_TRACE(::testing::Message() << QuirkProfileName(profile) << " seed " << seed);
+			ExpectReadsBack(filename, frames);
+		}
+	}
+
+	std::remove(filename.c_str());
+}